@@ -0,0 +1,388 @@
+#include "ai_cache.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <ctype.h>
+#include <pthread.h>
+
+// Find the executable PATH would run for cmd and stat it.
+static int resolve_command(const char *cmd, struct stat *st) {
+    if (!cmd || !*cmd) return 0;
+    if (strchr(cmd, '/')) {
+        return stat(cmd, st) == 0 && S_ISREG(st->st_mode);
+    }
+
+    const char *path_env = getenv("PATH");
+    if (!path_env || !*path_env) return 0;
+
+    char *path_copy = strdup(path_env);
+    if (!path_copy) return 0;
+
+    int found = 0;
+    char *saveptr = NULL;
+    for (char *dir = strtok_r(path_copy, ":", &saveptr); dir && !found;
+         dir = strtok_r(NULL, ":", &saveptr)) {
+        char full[1024];
+        snprintf(full, sizeof(full), "%s/%s", dir, cmd);
+        if (stat(full, st) == 0 && S_ISREG(st->st_mode) && access(full, X_OK) == 0) {
+            found = 1;
+        }
+    }
+
+    free(path_copy);
+    return found;
+}
+
+// Directory holding the cache files; created on demand.
+static int cache_dir(char *out, size_t out_sz) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    char base[768];
+    if (xdg && *xdg) {
+        snprintf(base, sizeof(base), "%s/ripple", xdg);
+    } else if (home && *home) {
+        snprintf(base, sizeof(base), "%s/.cache/ripple", home);
+    } else {
+        return 0;
+    }
+
+    // mkdir -p for the last two levels (XDG dir itself may not exist yet)
+    char parent[768];
+    snprintf(parent, sizeof(parent), "%s", base);
+    char *slash = strrchr(parent, '/');
+    if (slash) {
+        *slash = '\0';
+        mkdir(parent, 0700);
+    }
+    mkdir(base, 0700);
+
+    snprintf(out, out_sz, "%s/descriptions", base);
+    if (mkdir(out, 0700) != 0 && errno != EEXIST) return 0;
+    return 1;
+}
+
+// 64-bit FNV-1a, used to turn a cache key into a file name
+static uint64_t fnv1a(const char *s) {
+    uint64_t h = 1469598103934665603ULL;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Build the key line and the entry path for cmd. Returns 0 when the command
+// cannot be resolved (nothing to key on) or there is no cache directory.
+static int entry_for(const char *cmd, const char *model, char *key, size_t key_sz,
+                     char *path, size_t path_sz) {
+    struct stat st;
+    if (!resolve_command(cmd, &st)) return 0;
+
+    char dir[1024];
+    if (!cache_dir(dir, sizeof(dir))) return 0;
+
+    snprintf(key, key_sz, "%s %llu %llu %lld %lld %s",
+             cmd,
+             (unsigned long long)st.st_dev,
+             (unsigned long long)st.st_ino,
+             (long long)st.st_mtime,
+             (long long)st.st_size,
+             model ? model : "");
+    snprintf(path, path_sz, "%s/%016llx.desc", dir, (unsigned long long)fnv1a(key));
+    return 1;
+}
+
+// Returns the cached description (caller frees) or NULL on a miss.
+// A hit is a single read of one small file; its mtime is bumped so the
+// eviction pass treats it as recently used.
+char* desc_cache_lookup(const char* cmd, const char* model) {
+    char key[512];
+    char path[1200];
+    if (!entry_for(cmd, model, key, sizeof(key), path, sizeof(path))) return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    char buf[DESC_CACHE_MAX_ENTRY_BYTES + 600];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    if (n <= 0) {
+        close(fd);
+        return NULL;
+    }
+    buf[n] = '\0';
+
+    // First line must repeat the full key (guards against hash collisions)
+    size_t key_len = strlen(key);
+    if ((size_t)n <= key_len || strncmp(buf, key, key_len) != 0 || buf[key_len] != '\n') {
+        close(fd);
+        return NULL;
+    }
+
+    futimens(fd, NULL);
+    close(fd);
+    return strdup(buf + key_len + 1);
+}
+
+typedef struct {
+    char name[64];
+    time_t mtime;
+} CacheEntry;
+
+static int compare_entry_age(const void *a, const void *b) {
+    time_t ta = ((const CacheEntry *)a)->mtime;
+    time_t tb = ((const CacheEntry *)b)->mtime;
+    return (ta > tb) - (ta < tb);
+}
+
+// Keep at most DESC_CACHE_MAX_ENTRIES files, dropping the least recently used.
+static void evict_old_entries(const char *dir) {
+    DIR *d = opendir(dir);
+    if (!d) return;
+
+    int count = 0;
+    int cap = 64;
+    CacheEntry *entries = malloc(cap * sizeof(CacheEntry));
+    if (!entries) {
+        closedir(d);
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len < 6 || len >= sizeof(entries[0].name) || strcmp(ent->d_name + len - 5, ".desc") != 0) continue;
+
+        struct stat st;
+        if (fstatat(dirfd(d), ent->d_name, &st, 0) != 0) continue;
+
+        if (count >= cap) {
+            cap *= 2;
+            CacheEntry *temp = realloc(entries, cap * sizeof(CacheEntry));
+            if (!temp) break;
+            entries = temp;
+        }
+        memcpy(entries[count].name, ent->d_name, len + 1);
+        entries[count].mtime = st.st_mtime;
+        count++;
+    }
+
+    if (count > DESC_CACHE_MAX_ENTRIES) {
+        qsort(entries, count, sizeof(CacheEntry), compare_entry_age);
+        for (int i = 0; i < count - DESC_CACHE_MAX_ENTRIES; i++) {
+            unlinkat(dirfd(d), entries[i].name, 0);
+        }
+    }
+
+    free(entries);
+    closedir(d);
+}
+
+void desc_cache_store(const char* cmd, const char* model, const char* text) {
+    if (!text || !*text || strlen(text) > DESC_CACHE_MAX_ENTRY_BYTES) return;
+
+    char key[512];
+    char path[1200];
+    if (!entry_for(cmd, model, key, sizeof(key), path, sizeof(path))) return;
+
+    // Write to a temp file and rename so readers never see a partial entry
+    char tmp[1300];
+    snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid());
+    FILE *fp = fopen(tmp, "w");
+    if (!fp) return;
+    int ok = fprintf(fp, "%s\n%s", key, text) >= 0;
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return;
+    }
+
+    char *slash = strrchr(path, '/');
+    if (slash) {
+        *slash = '\0';
+        evict_old_entries(path);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// In-memory completion cache: hash map for lookup plus an intrusive doubly
+// linked list ordered by use (head = most recent) for LRU eviction.
+// ---------------------------------------------------------------------------
+
+typedef struct CompletionEntry {
+    uint64_t hash;
+    char *key;
+    char *text;
+    unsigned long cost_ms;
+    struct CompletionEntry *chain;   // next entry in the same bucket
+    struct CompletionEntry *prev;    // LRU list
+    struct CompletionEntry *next;
+} CompletionEntry;
+
+static struct {
+    pthread_mutex_t lock;
+    CompletionEntry *buckets[COMPLETION_CACHE_BUCKETS];
+    CompletionEntry *head;
+    CompletionEntry *tail;
+    int count;
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long saved_ms;
+} g_completions = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// Surrounding whitespace trimmed and inner runs collapsed to one space, so
+// "gi  t " and "gi t" share an entry
+size_t completion_normalize(const char* prompt, char* out, size_t out_sz) {
+    if (out_sz == 0) return 0;
+    size_t j = 0;
+    int pending_space = 0;
+    for (const char *p = prompt; *p && j + 1 < out_sz; p++) {
+        if (isspace((unsigned char)*p)) {
+            pending_space = 1;
+            continue;
+        }
+        if (pending_space && j > 0) {
+            if (j + 2 >= out_sz) break;
+            out[j++] = ' ';
+        }
+        pending_space = 0;
+        out[j++] = *p;
+    }
+    out[j] = '\0';
+    return j;
+}
+
+// Key = params + '\n' + the normalized prompt
+static char *completion_key(const char *prompt, const char *params) {
+    size_t plen = params ? strlen(params) : 0;
+    size_t room = strlen(prompt) + 1;
+    char *key = malloc(plen + room + 1);
+    if (!key) return NULL;
+
+    memcpy(key, params ? params : "", plen);
+    key[plen] = '\n';
+    completion_normalize(prompt, key + plen + 1, room);
+    return key;
+}
+
+static void lru_unlink(CompletionEntry *e) {
+    if (e->prev) e->prev->next = e->next; else g_completions.head = e->next;
+    if (e->next) e->next->prev = e->prev; else g_completions.tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(CompletionEntry *e) {
+    e->prev = NULL;
+    e->next = g_completions.head;
+    if (g_completions.head) g_completions.head->prev = e;
+    g_completions.head = e;
+    if (!g_completions.tail) g_completions.tail = e;
+}
+
+static CompletionEntry *completion_find(const char *key, uint64_t hash) {
+    CompletionEntry *e = g_completions.buckets[hash & (COMPLETION_CACHE_BUCKETS - 1)];
+    for (; e; e = e->chain) {
+        if (e->hash == hash && strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static void completion_remove(CompletionEntry *e) {
+    CompletionEntry **pp = &g_completions.buckets[e->hash & (COMPLETION_CACHE_BUCKETS - 1)];
+    while (*pp && *pp != e) pp = &(*pp)->chain;
+    if (*pp) *pp = e->chain;
+    lru_unlink(e);
+    free(e->key);
+    free(e->text);
+    free(e);
+    g_completions.count--;
+}
+
+// Returns a copy of the cached answer (caller frees) or NULL on a miss.
+char* completion_cache_lookup(const char* prompt, const char* params) {
+    if (!prompt) return NULL;
+    char *key = completion_key(prompt, params);
+    if (!key) return NULL;
+    uint64_t hash = fnv1a(key);
+
+    char *result = NULL;
+    pthread_mutex_lock(&g_completions.lock);
+    CompletionEntry *e = completion_find(key, hash);
+    if (e) {
+        lru_unlink(e);
+        lru_push_front(e);
+        g_completions.hits++;
+        g_completions.saved_ms += e->cost_ms;
+        result = strdup(e->text);
+    } else {
+        g_completions.misses++;
+    }
+    pthread_mutex_unlock(&g_completions.lock);
+
+    free(key);
+    return result;
+}
+
+void completion_cache_store(const char* prompt, const char* params, const char* text, unsigned long cost_ms) {
+    if (!prompt || !text) return;
+    char *key = completion_key(prompt, params);
+    if (!key) return;
+    uint64_t hash = fnv1a(key);
+
+    pthread_mutex_lock(&g_completions.lock);
+    CompletionEntry *e = completion_find(key, hash);
+    if (e) {
+        // Refresh an existing answer in place
+        char *copy = strdup(text);
+        if (copy) {
+            free(e->text);
+            e->text = copy;
+            e->cost_ms = cost_ms;
+        }
+        lru_unlink(e);
+        lru_push_front(e);
+        free(key);
+    } else {
+        e = calloc(1, sizeof(CompletionEntry));
+        char *copy = strdup(text);
+        if (!e || !copy) {
+            free(e);
+            free(copy);
+            free(key);
+            pthread_mutex_unlock(&g_completions.lock);
+            return;
+        }
+        e->hash = hash;
+        e->key = key;
+        e->text = copy;
+        e->cost_ms = cost_ms;
+
+        size_t b = hash & (COMPLETION_CACHE_BUCKETS - 1);
+        e->chain = g_completions.buckets[b];
+        g_completions.buckets[b] = e;
+        lru_push_front(e);
+        g_completions.count++;
+
+        while (g_completions.count > COMPLETION_CACHE_CAPACITY && g_completions.tail) {
+            completion_remove(g_completions.tail);
+        }
+    }
+    pthread_mutex_unlock(&g_completions.lock);
+}
+
+void completion_cache_stats(CompletionCacheStats* out) {
+    if (!out) return;
+    pthread_mutex_lock(&g_completions.lock);
+    out->hits = g_completions.hits;
+    out->misses = g_completions.misses;
+    out->saved_ms = g_completions.saved_ms;
+    out->entries = g_completions.count;
+    pthread_mutex_unlock(&g_completions.lock);
+}
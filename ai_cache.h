@@ -0,0 +1,35 @@
+#ifndef AI_CACHE_H
+#define AI_CACHE_H
+
+#include <stddef.h>
+
+// On-disk cache of AI command descriptions.
+// Entries live under $XDG_CACHE_HOME/ripple/descriptions (or ~/.cache/...)
+// and are keyed by command name, the resolved binary's inode/mtime/size and
+// the model name, so upgrading a binary invalidates its entry by itself.
+char* desc_cache_lookup(const char* cmd, const char* model);
+void desc_cache_store(const char* cmd, const char* model, const char* text);
+
+// In-memory LRU cache for fallback completions (get_ollama_completion).
+// Keyed on the normalized partial command plus the model parameters.
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long saved_ms;   // model time the hits did not have to spend
+    int entries;
+} CompletionCacheStats;
+
+char* completion_cache_lookup(const char* prompt, const char* params);
+void completion_cache_store(const char* prompt, const char* params, const char* text, unsigned long cost_ms);
+void completion_cache_stats(CompletionCacheStats* out);
+// The form of a prompt the cache keys on: whitespace trimmed and collapsed.
+// Returns its length (truncated to fit out_sz).
+size_t completion_normalize(const char* prompt, char* out, size_t out_sz);
+
+// Constants
+#define DESC_CACHE_MAX_ENTRIES 512
+#define DESC_CACHE_MAX_ENTRY_BYTES 4096
+#define COMPLETION_CACHE_CAPACITY 128
+#define COMPLETION_CACHE_BUCKETS 256   // power of two
+
+#endif // AI_CACHE_H
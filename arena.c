@@ -0,0 +1,87 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t used;
+    size_t cap;
+    max_align_t data[];
+};
+
+#define ARENA_ALIGN (sizeof(max_align_t))
+
+void arena_init(Arena* a, size_t block_size) {
+    a->head = NULL;
+    a->current = NULL;
+    a->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+}
+
+static ArenaBlock *new_block(size_t cap) {
+    ArenaBlock *b = malloc(sizeof(ArenaBlock) + cap);
+    if (!b) return NULL;
+    b->next = NULL;
+    b->used = 0;
+    b->cap = cap;
+    return b;
+}
+
+// Returns NULL only when the system is out of memory.
+void* arena_alloc(Arena* a, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (size == 0) size = ARENA_ALIGN;
+
+    // Try the current block, then blocks kept from before the last reset
+    while (a->current) {
+        ArenaBlock *b = a->current;
+        if (b->cap - b->used >= size) {
+            void *p = (char *)b->data + b->used;
+            b->used += size;
+            return p;
+        }
+        if (!b->next) break;
+        a->current = b->next;
+        a->current->used = 0;
+    }
+
+    size_t cap = size > a->block_size ? size : a->block_size;
+    ArenaBlock *b = new_block(cap);
+    if (!b) return NULL;
+    if (a->current) {
+        a->current->next = b;
+    } else {
+        a->head = b;
+    }
+    a->current = b;
+    b->used = size;
+    return b->data;
+}
+
+char* arena_strndup(Arena* a, const char* s, size_t len) {
+    char *p = arena_alloc(a, len + 1);
+    if (!p) return NULL;
+    memcpy(p, s, len);
+    p[len] = '\0';
+    return p;
+}
+
+char* arena_strdup(Arena* a, const char* s) {
+    return arena_strndup(a, s, strlen(s));
+}
+
+// Forget every allocation but keep the blocks for the next round.
+void arena_reset(Arena* a) {
+    a->current = a->head;
+    if (a->head) a->head->used = 0;
+}
+
+void arena_free(Arena* a) {
+    ArenaBlock *b = a->head;
+    while (b) {
+        ArenaBlock *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+    a->current = NULL;
+}
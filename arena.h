@@ -0,0 +1,27 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator. Allocations are carved out of large blocks and released
+// all at once: arena_reset() keeps the blocks for reuse, arena_free()
+// returns them to the system.
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    ArenaBlock *current;
+    size_t block_size;
+} Arena;
+
+void arena_init(Arena* a, size_t block_size);
+void* arena_alloc(Arena* a, size_t size);
+char* arena_strndup(Arena* a, const char* s, size_t len);
+char* arena_strdup(Arena* a, const char* s);
+void arena_reset(Arena* a);
+void arena_free(Arena* a);
+
+// Constants
+#define ARENA_DEFAULT_BLOCK 16384
+
+#endif // ARENA_H
@@ -0,0 +1,335 @@
+#include "builtins.h"
+#include <string.h>
+#include <strings.h>
+
+// Keep this table sorted by name: builtin_find() binary-searches it.
+const Builtin BUILTINS[] = {
+    {
+        "aistats",
+        ripple_aistats,
+        "Show AI cache statistics",
+        "Shows how often AI completions were answered from the in-memory cache instead of asking Ollama again.",
+        "aistats",
+        "Examples:\n"
+        "  aistats\n",
+        "Notes:\n"
+        "  Counters cover the current session only.\n",
+        "history, version"
+    },
+    {
+        "bg",
+        ripple_bg,
+        "Run a command in the background",
+        "Runs an external command in the background (does not block the shell).",
+        "bg <command> [args...]",
+        "Examples:\n"
+        "  bg sleep 5\n"
+        "  bg python3 script.py\n",
+        "Notes:\n"
+        "  This starts external programs with posix_spawn().\n"
+        "  Output and job control are minimal.\n",
+        "history, help"
+    },
+    {
+        "calc",
+        ripple_calc,
+        "Simple calculator",
+        "Evaluates a simple binary arithmetic expression.",
+        "calc <number> <operator> <number>\nOperators: +  -  *  /  %  ^",
+        "Examples:\n"
+        "  calc 10 + 5\n"
+        "  calc 2 ^ 8\n",
+        "Notes:\n"
+        "  Division by zero is checked.\n",
+        "echo, datetime"
+    },
+    {
+        "cat",
+        ripple_cat,
+        "Print a file to the screen",
+        "Prints one or more files, one after another; with no file (or -) it copies standard input.",
+        "cat [-n] [file...]",
+        "Examples:\n"
+        "  cat README.md\n"
+        "  cat -n shell2_complete.c\n"
+        "  cat part1.log part2.log > all.log\n",
+        "Options:\n"
+        "  -n  Number every line, continuing across files\n"
+        "Notes:\n"
+        "  Files are copied byte for byte, binary ones included; into a file or pipe the kernel moves the data directly.\n",
+        "ls, find"
+    },
+    {
+        "cd",
+        ripple_cd,
+        "Change directory (move between folders)",
+        "The cd command stands for Change Directory.\nIt changes your current working directory in the shell (moves you from one folder to another).",
+        "cd <directory>\ncd\ncd ~",
+        "Examples:\n"
+        "  cd Documents\n"
+        "  cd ..\n"
+        "  cd /tmp\n",
+        "Common cd forms:\n"
+        "  cd /        - Go to the root directory\n"
+        "  cd ~ or cd  - Go to your home directory\n"
+        "  cd ..       - Move one level up (parent directory)\n"
+        "  cd ../..    - Move two levels up\n"
+        "  cd -        - Go back to the previous directory (note: not implemented in this shell)\n",
+        "pwd, ls, tree"
+    },
+    {
+        "clear",
+        ripple_clear,
+        "Clear the screen",
+        "Clears the terminal screen using ANSI escape codes.",
+        "clear",
+        "Examples:\n"
+        "  clear\n",
+        "Tip:\n"
+        "  If your terminal scrollback is messy, clear can help.\n",
+        "help"
+    },
+    {
+        "count",
+        ripple_count,
+        "Count files and directories",
+        "Counts items in a directory and prints totals by type (directories, files, symlinks, other) and how long it took.",
+        "count [-r] [-p] [--bytes] [path]",
+        "Examples:\n"
+        "  count\n"
+        "  count ..\n"
+        "  count -r --bytes src\n",
+        "Options:\n"
+        "  -r       Count the whole tree below path\n"
+        "  -p       Like -r, with one thread per CPU\n"
+        "  --bytes  Also total the size of regular files\n"
+        "Notes:\n"
+        "  Types come from the directory listing itself; symlinks are counted, not followed.\n",
+        "ls, tree, find"
+    },
+    {
+        "datetime",
+        ripple_datetime,
+        "Show date and time",
+        "Prints the current date and time in a friendly format.",
+        "datetime",
+        "Examples:\n"
+        "  datetime\n",
+        "Related:\n"
+        "  Useful for timestamps and quick checks.\n",
+        "version, pwd"
+    },
+    {
+        "echo",
+        ripple_echo,
+        "Print text",
+        "Prints the given text to the terminal.",
+        "echo <text...>",
+        "Examples:\n"
+        "  echo hello\n"
+        "  echo \"hello world\"\n",
+        "Notes:\n"
+        "  This is a simple echo; it does not support advanced flags.\n",
+        "pwd, ls"
+    },
+    {
+        "exit",
+        ripple_exit,
+        "Exit the shell",
+        "Exits the shell program and returns you to your normal terminal.",
+        "exit",
+        "Examples:\n"
+        "  exit\n",
+        "Notes:\n"
+        "  Background jobs (& or bg) are reaped as they finish while the shell runs.\n"
+        "  Jobs still running at exit are left running.\n",
+        "help"
+    },
+    {
+        "find",
+        ripple_find,
+        "Find files by name pattern",
+        "Recursively searches for files matching a glob pattern (e.g., *.c).",
+        "find <pattern>",
+        "Examples:\n"
+        "  find \"*.c\"\n"
+        "  find \"*.txt\"\n",
+        "Notes:\n"
+        "  Pattern matching uses fnmatch().\n",
+        "ls, tree, count"
+    },
+    {
+        "help",
+        ripple_help,
+        "Show available built-in commands",
+        "Prints a list of the built-in commands supported by this shell.",
+        "help",
+        "Examples:\n"
+        "  help\n",
+        "Tip:\n"
+        "  Use TAB on a command name (e.g., 'cd' then TAB) to see detailed help.\n",
+        "version, history, pwd"
+    },
+    {
+        "history",
+        ripple_history,
+        "Show command history",
+        "Shows previously executed commands, including those of earlier sessions.",
+        "history",
+        "Examples:\n"
+        "  history\n",
+        "Notes:\n"
+        "  Saved across sessions in ~/.ripple_history (or $RIPPLE_HISTFILE).\n"
+        "  With RIPPLE_SHARE_HISTORY=1, shells running at the same time pick up\n"
+        "  each other's commands at the next prompt.\n",
+        "help"
+    },
+    {
+        "ls",
+        ripple_ls,
+        "List directory contents",
+        "Lists files and folders sorted by name, in columns on a terminal and one per line when piped.",
+        "ls [-a] [-l] [path...]",
+        "Examples:\n"
+        "  ls\n"
+        "  ls -l ..\n"
+        "  ls -la src include\n",
+        "Options:\n"
+        "  -a  Include hidden entries (names starting with .)\n"
+        "  -l  Long format: mode, links, owner, group, size, modification time\n"
+        "Notes:\n"
+        "  Names sort by byte value regardless of locale, so uppercase comes before lowercase.\n",
+        "tree, count, find"
+    },
+    {
+        "mkdir",
+        ripple_mkdir,
+        "Create a directory",
+        "Creates a new directory.",
+        "mkdir <directory_name>",
+        "Examples:\n"
+        "  mkdir test_folder\n",
+        "Notes:\n"
+        "  Permissions are set to 0755.\n",
+        "touch, rm, ls"
+    },
+    {
+        "pwd",
+        ripple_pwd,
+        "Print working directory",
+        "Prints the current working directory path.",
+        "pwd",
+        "Examples:\n"
+        "  pwd\n",
+        "Related:\n"
+        "  cd changes directories; pwd shows where you are.\n",
+        "cd, ls, tree"
+    },
+    {
+        "rm",
+        ripple_rm,
+        "Remove a file",
+        "Removes (deletes) a file.",
+        "rm <filename>",
+        "Examples:\n"
+        "  rm notes.txt\n",
+        "Warning:\n"
+        "  This permanently deletes the file (no trash).\n",
+        "ls, touch, mkdir"
+    },
+    {
+        "touch",
+        ripple_touch,
+        "Create an empty file",
+        "Creates a file if it doesn't exist (or updates its timestamp).",
+        "touch <filename>",
+        "Examples:\n"
+        "  touch notes.txt\n",
+        "Notes:\n"
+        "  This uses fopen(..., \"a\") to create/update.\n",
+        "cat, ls, rm"
+    },
+    {
+        "tree",
+        ripple_tree,
+        "Show directory tree",
+        "Displays a tree view of a directory (folders and files).",
+        "tree\ntree <path>",
+        "Examples:\n"
+        "  tree\n"
+        "  tree ..\n",
+        "Related:\n"
+        "  Use ls for a flat list; tree for structure.\n",
+        "ls, count, find"
+    },
+    {
+        "version",
+        ripple_version,
+        "Show shell version",
+        "Displays the version of this AI Automated Custom Shell.",
+        "version",
+        "Examples:\n"
+        "  version\n",
+        "Common version flags (general, not implemented here):\n"
+        "  --version  - Version info (many tools)\n"
+        "  -v         - Short version output\n"
+        "  -V         - Detailed version output\n"
+        "  about      - App info (some CLIs)\n",
+        "help, whoami, pwd"
+    },
+    {
+        "whoami",
+        ripple_whoami,
+        "Show current user",
+        "Prints the current username (from the USER environment variable).",
+        "whoami",
+        "Examples:\n"
+        "  whoami\n",
+        "Notes:\n"
+        "  If USER is not set, it prints 'Unknown user'.\n",
+        "pwd, version, help"
+    }
+};
+
+const size_t BUILTIN_COUNT = sizeof(BUILTINS) / sizeof(BUILTINS[0]);
+
+// Exact, case-sensitive lookup used to dispatch commands
+const Builtin* builtin_find(const char* name) {
+    size_t lo = 0, hi = BUILTIN_COUNT;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcmp(BUILTINS[mid].name, name);
+        if (c == 0) return &BUILTINS[mid];
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
+
+// Index of the first builtin not before prefix in case-insensitive order;
+// every name starting with prefix follows it contiguously
+size_t builtin_prefix_start(const char* prefix) {
+    size_t len = strlen(prefix);
+    size_t lo = 0, hi = BUILTIN_COUNT;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strncasecmp(BUILTINS[mid].name, prefix, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Case-insensitive lookup used for help ("CD" + TAB). Names are lowercase,
+// so the table is in case-insensitive order too.
+const Builtin* builtin_find_icase(const char* name) {
+    if (!name) return NULL;
+    size_t lo = 0, hi = BUILTIN_COUNT;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = strcasecmp(BUILTINS[mid].name, name);
+        if (c == 0) return &BUILTINS[mid];
+        if (c < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
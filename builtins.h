@@ -0,0 +1,53 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include <stddef.h>
+
+// Built-in commands. Everything the shell knows about a builtin lives in
+// one BUILTINS entry: the function that runs it, and the help and
+// completion text. Adding a builtin means adding its function and one entry.
+typedef int (*builtin_fn)(char **args);
+
+typedef struct {
+    const char *name;
+    builtin_fn run;       // returns 0 to make the shell exit
+    const char *summary;
+    const char *what;
+    const char *usage;
+    const char *examples; // multiline
+    const char *common;   // multiline (tables/bullets)
+    const char *related;  // comma-separated
+} Builtin;
+
+// Sorted by name, so lookups are a binary search
+extern const Builtin BUILTINS[];
+extern const size_t BUILTIN_COUNT;
+
+const Builtin* builtin_find(const char* name);
+const Builtin* builtin_find_icase(const char* name);
+size_t builtin_prefix_start(const char* prefix);
+
+// Defined in shell2_complete.c
+int ripple_cd(char **args);
+int ripple_help(char **args);
+int ripple_exit(char **args);
+int ripple_bg(char **args);
+int ripple_history(char **args);
+int ripple_clear(char **args);
+int ripple_echo(char **args);
+int ripple_pwd(char **args);
+int ripple_ls(char **args);
+int ripple_version(char **args);
+int ripple_calc(char **args);
+int ripple_datetime(char **args);
+int ripple_count(char **args);
+int ripple_find(char **args);
+int ripple_cat(char **args);
+int ripple_tree(char **args);
+int ripple_mkdir(char **args);
+int ripple_touch(char **args);
+int ripple_rm(char **args);
+int ripple_whoami(char **args);
+int ripple_aistats(char **args);
+
+#endif // BUILTINS_H
@@ -0,0 +1,158 @@
+#define _GNU_SOURCE   // copy_file_range, splice
+#include "copy.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#define COPY_NUMBER_MAX 24              // room for one "%6llu\t" prefix
+
+typedef enum {
+    COPY_FILE_RANGE,
+    COPY_SENDFILE,
+    COPY_SPLICE
+} CopyMethod;
+
+// Allocated on first use and kept: page aligned, the size the kernel
+// handles best for plain reads
+static char *g_copy_buf;
+static char *g_number_buf;
+
+static char *copy_buffer(char **buf) {
+    if (!*buf) {
+        void *p = NULL;
+        if (posix_memalign(&p, 4096, COPY_BUFSIZE) != 0) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        *buf = p;
+    }
+    return *buf;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+#ifdef __linux__
+// Returns 1 at end of input, 0 when the kernel will not do this copy (the
+// caller carries on with another method from the current offset), -1 on
+// a real error.
+static int copy_kernel(int in_fd, int out_fd, CopyMethod how) {
+    for (;;) {
+        ssize_t n;
+        if (how == COPY_FILE_RANGE) {
+            n = copy_file_range(in_fd, NULL, out_fd, NULL, COPY_KERNEL_CHUNK, 0);
+        } else if (how == COPY_SENDFILE) {
+            n = sendfile(out_fd, in_fd, NULL, COPY_KERNEL_CHUNK);
+        } else {
+            n = splice(in_fd, NULL, out_fd, NULL, COPY_KERNEL_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+        }
+        if (n > 0) continue;
+        if (n == 0) return 1;
+        if (errno == EINTR) continue;
+        // Unsupported pairing: other filesystems, O_APPEND outputs, old kernels
+        if (errno == EINVAL || errno == ENOSYS || errno == EXDEV ||
+            errno == EOPNOTSUPP || errno == EBADF) {
+            return 0;
+        }
+        return -1;
+    }
+}
+#endif
+
+static int copy_read_write(int in_fd, int out_fd) {
+    char *buf = copy_buffer(&g_copy_buf);
+    if (!buf) return -1;
+    for (;;) {
+        ssize_t n = read(in_fd, buf, COPY_BUFSIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) return 0;
+        if (write_all(out_fd, buf, (size_t)n) != 0) return -1;
+    }
+}
+
+int copy_fd(int in_fd, int out_fd) {
+#ifdef __linux__
+    struct stat in_st, out_st;
+    if (fstat(in_fd, &in_st) != 0 || fstat(out_fd, &out_st) != 0) return -1;
+    int in_reg = S_ISREG(in_st.st_mode);
+    int in_pipe = S_ISFIFO(in_st.st_mode);
+    int out_reg = S_ISREG(out_st.st_mode);
+    int out_pipe = S_ISFIFO(out_st.st_mode);
+    int done = 0;
+
+    // st_size == 0 covers /proc and friends, whose size says nothing about
+    // how much there is to read; they are read the ordinary way
+    if (in_reg && in_st.st_size > 0 && !S_ISCHR(out_st.st_mode)) {
+        if (out_reg) done = copy_kernel(in_fd, out_fd, COPY_FILE_RANGE);
+        if (done == 0) done = copy_kernel(in_fd, out_fd, COPY_SENDFILE);
+    }
+    if (done == 0 && (in_pipe || out_pipe) && (in_reg || in_pipe) && (out_reg || out_pipe)) {
+        done = copy_kernel(in_fd, out_fd, COPY_SPLICE);
+    }
+    if (done != 0) return done < 0 ? -1 : 0;
+#endif
+    return copy_read_write(in_fd, out_fd);
+}
+
+int copy_fd_numbered(int in_fd, int out_fd, CopyLines* lines) {
+    char *in = copy_buffer(&g_copy_buf);
+    char *out = copy_buffer(&g_number_buf);
+    if (!in || !out) return -1;
+    size_t out_len = 0;
+
+    for (;;) {
+        ssize_t n = read(in_fd, in, COPY_BUFSIZE);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return -1;
+        if (n == 0) break;
+
+        const char *p = in;
+        const char *end = in + n;
+        while (p < end) {
+            if (out_len + COPY_NUMBER_MAX > COPY_BUFSIZE) {
+                if (write_all(out_fd, out, out_len) != 0) return -1;
+                out_len = 0;
+            }
+            if (lines->at_line_start) {
+                out_len += (size_t)snprintf(out + out_len, COPY_NUMBER_MAX, "%6llu\t", ++lines->line);
+                lines->at_line_start = 0;
+            }
+            // memchr is the vectorized scan; a whole line moves with one memcpy
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(end - p);
+            if (len > COPY_BUFSIZE - out_len) {
+                // Longer than the room left: send what is queued, then the
+                // line straight from the input buffer
+                if (write_all(out_fd, out, out_len) != 0) return -1;
+                out_len = 0;
+                if (write_all(out_fd, p, len) != 0) return -1;
+            } else {
+                memcpy(out + out_len, p, len);
+                out_len += len;
+            }
+            p += len;
+            if (nl) lines->at_line_start = 1;
+        }
+        // One write per read, so output from a slow pipe is not held back
+        if (write_all(out_fd, out, out_len) != 0) return -1;
+        out_len = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef COPY_H
+#define COPY_H
+
+// Descriptor-to-descriptor copying for cat.
+// On Linux the data stays in the kernel where it can: copy_file_range()
+// between regular files, sendfile() from a regular file to anything else
+// that is not a terminal, splice() when either end is a pipe. Terminals,
+// other devices and whatever the kernel refuses go through read()/write()
+// with one large aligned buffer. A kernel copy that stops part way is
+// finished by the next method from the current file offset.
+
+// Line numbering state, carried from one input to the next
+typedef struct {
+    unsigned long long line;    // last number printed
+    int at_line_start;          // the next byte starts a line; set to 1 first
+} CopyLines;
+
+// Copy in_fd to out_fd until end of input. Returns 0, or -1 with errno set.
+int copy_fd(int in_fd, int out_fd);
+// Same, prefixing every line with its number like cat -n ("%6llu\t")
+int copy_fd_numbered(int in_fd, int out_fd, CopyLines* lines);
+
+// Constants
+#define COPY_BUFSIZE (256 * 1024)       // read()/write() fallback and -n
+#define COPY_KERNEL_CHUNK (1 << 30)     // bytes asked for per kernel call
+
+#endif // COPY_H
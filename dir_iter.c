@@ -0,0 +1,120 @@
+#include "dir_iter.h"
+#include <sys/types.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#ifdef __linux__
+// Layout of the records getdents64 fills the buffer with
+struct linux_dirent64 {
+    unsigned long long d_ino;
+    long long d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+#endif
+
+static int is_dot_or_dotdot(const char *name) {
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+int dir_iter_open(DirIter* it, int dir_fd, const char* path, void* buf, size_t cap) {
+    memset(it, 0, sizeof(*it));
+    it->fd = openat(dir_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (it->fd < 0) return -1;
+    it->owns_fd = 1;
+
+#ifdef __linux__
+    if (buf && cap >= 4096) {
+        it->buf = buf;
+        it->cap = cap;
+    } else {
+        it->buf = malloc(DIR_ITER_BUFSIZE);
+        it->cap = DIR_ITER_BUFSIZE;
+        it->owns_buf = 1;
+        if (!it->buf) {
+            close(it->fd);
+            it->fd = -1;
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+#else
+    // readdir keeps its own buffer; it gets a duplicate so dir_iter_fd()
+    // stays usable and closedir() does not close the caller's descriptor
+    int dup_fd = dup(it->fd);
+    it->dir = dup_fd >= 0 ? fdopendir(dup_fd) : NULL;
+    if (!it->dir) {
+        int err = errno;
+        if (dup_fd >= 0) close(dup_fd);
+        close(it->fd);
+        it->fd = -1;
+        errno = err;
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+int dir_iter_next(DirIter* it, DirEntry* e) {
+#ifdef __linux__
+    for (;;) {
+        if (it->pos >= it->len) {
+            long n = syscall(SYS_getdents64, it->fd, it->buf, it->cap);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) return -1;
+            if (n == 0) return 0;
+            it->pos = 0;
+            it->len = (size_t)n;
+        }
+        struct linux_dirent64 *d = (struct linux_dirent64 *)(it->buf + it->pos);
+        it->pos += d->d_reclen;
+        if (is_dot_or_dotdot(d->d_name)) continue;
+        e->name = d->d_name;
+        e->name_len = strlen(d->d_name);
+        e->type = d->d_type;
+        return 1;
+    }
+#else
+    struct dirent *d;
+    errno = 0;
+    while ((d = readdir((DIR *)it->dir)) != NULL) {
+        if (is_dot_or_dotdot(d->d_name)) continue;
+        e->name = d->d_name;
+        e->name_len = strlen(d->d_name);
+#ifdef DT_UNKNOWN
+        e->type = d->d_type;
+#else
+        e->type = 0;
+#endif
+        return 1;
+    }
+    return errno ? -1 : 0;
+#endif
+}
+
+int dir_iter_fd(const DirIter* it) {
+    return it->fd;
+}
+
+int dir_iter_take_fd(DirIter* it) {
+    it->owns_fd = 0;
+    return it->fd;
+}
+
+void dir_iter_close(DirIter* it) {
+    if (it->dir) closedir((DIR *)it->dir);
+    if (it->fd >= 0 && it->owns_fd) close(it->fd);
+    if (it->owns_buf) free(it->buf);
+    it->dir = NULL;
+    it->fd = -1;
+    it->buf = NULL;
+    it->owns_buf = 0;
+}
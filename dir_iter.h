@@ -0,0 +1,44 @@
+#ifndef DIR_ITER_H
+#define DIR_ITER_H
+
+#include <stddef.h>
+
+// Directory reader for the directory builtins and the tree walker.
+// On Linux entries are read with getdents64 in large batches straight into
+// a buffer the caller can reuse between directories, and handed out as
+// slices of it, so there is no per-entry copy and no small default-sized
+// reads. Elsewhere it wraps readdir(). "." and ".." are skipped.
+typedef struct {
+    const char *name;       // NUL-terminated; valid until the next dir_iter_next()
+    size_t name_len;
+    unsigned char type;     // d_type; DT_UNKNOWN when the filesystem does not say
+} DirEntry;
+
+typedef struct {
+    int fd;
+    int owns_fd;
+    char *buf;
+    size_t cap;
+    size_t pos;
+    size_t len;
+    int owns_buf;
+    void *dir;              // DIR* of the readdir fallback
+} DirIter;
+
+// Open path relative to dir_fd (AT_FDCWD for the working directory).
+// buf/cap may be NULL/0 to let the iterator allocate its own; a caller
+// supplied buffer must be suitably aligned (see DIR_ITER_BUFSIZE).
+// Returns 0, or -1 with errno set.
+int dir_iter_open(DirIter* it, int dir_fd, const char* path, void* buf, size_t cap);
+// Returns 1 with *e filled in, 0 at the end, -1 on a read error
+int dir_iter_next(DirIter* it, DirEntry* e);
+// Descriptor of the open directory, for openat()/fstatat() on its entries
+int dir_iter_fd(const DirIter* it);
+// Keep the descriptor open past dir_iter_close(); the caller closes it
+int dir_iter_take_fd(DirIter* it);
+void dir_iter_close(DirIter* it);
+
+// Constants
+#define DIR_ITER_BUFSIZE 65536  // one getdents64 batch; allocate as long long[]
+
+#endif // DIR_ITER_H
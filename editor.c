@@ -0,0 +1,257 @@
+#include "editor.h"
+#include "term.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ---------------------------------------------------------------------------
+// Gap buffer
+// ---------------------------------------------------------------------------
+
+void gap_init(GapBuffer* g) {
+    g->text = NULL;
+    g->cap = 0;
+    g->gap_start = 0;
+    g->gap_end = 0;
+}
+
+void gap_free(GapBuffer* g) {
+    free(g->text);
+    gap_init(g);
+}
+
+size_t gap_length(const GapBuffer* g) {
+    return g->cap - (g->gap_end - g->gap_start);
+}
+
+char gap_at(const GapBuffer* g, size_t i) {
+    return i < g->gap_start ? g->text[i] : g->text[i + (g->gap_end - g->gap_start)];
+}
+
+void gap_move(GapBuffer* g, size_t pos) {
+    size_t len = gap_length(g);
+    if (pos > len) pos = len;
+    if (pos < g->gap_start) {
+        size_t n = g->gap_start - pos;
+        memmove(g->text + g->gap_end - n, g->text + pos, n);
+        g->gap_start -= n;
+        g->gap_end -= n;
+    } else if (pos > g->gap_start) {
+        size_t n = pos - g->gap_start;
+        memmove(g->text + g->gap_start, g->text + g->gap_end, n);
+        g->gap_start += n;
+        g->gap_end += n;
+    }
+}
+
+// Grow so the gap holds at least need bytes (plus one spare for gap_text's NUL)
+static int gap_reserve(GapBuffer* g, size_t need) {
+    if (g->gap_end - g->gap_start > need) return 1;
+
+    size_t len = gap_length(g);
+    size_t cap = g->cap ? g->cap : GAP_INITIAL_SIZE;
+    while (cap - len <= need) cap *= 2;
+    char *text = malloc(cap);
+    if (!text) return 0;
+
+    size_t tail = g->cap - g->gap_end;
+    if (g->text) {
+        memcpy(text, g->text, g->gap_start);
+        memcpy(text + cap - tail, g->text + g->gap_end, tail);
+    }
+    free(g->text);
+    g->text = text;
+    g->gap_end = cap - tail;
+    g->cap = cap;
+    return 1;
+}
+
+int gap_insert(GapBuffer* g, const char* s, size_t n) {
+    if (!gap_reserve(g, n)) return 0;
+    memcpy(g->text + g->gap_start, s, n);
+    g->gap_start += n;
+    return 1;
+}
+
+void gap_delete_before(GapBuffer* g, size_t n) {
+    if (n > g->gap_start) n = g->gap_start;
+    g->gap_start -= n;
+}
+
+void gap_delete_after(GapBuffer* g, size_t n) {
+    size_t tail = g->cap - g->gap_end;
+    if (n > tail) n = tail;
+    g->gap_end += n;
+}
+
+int gap_set(GapBuffer* g, const char* s) {
+    g->gap_start = 0;
+    g->gap_end = g->cap;
+    return gap_insert(g, s, strlen(s));
+}
+
+const char* gap_text(GapBuffer* g) {
+    if (!gap_reserve(g, 0)) return "";
+    gap_move(g, gap_length(g));
+    g->text[g->gap_start] = '\0';
+    return g->text;
+}
+
+char* gap_strdup(const GapBuffer* g) {
+    size_t len = gap_length(g);
+    char *s = malloc(len + 1);
+    if (!s) return NULL;
+    memcpy(s, g->text, g->gap_start);
+    memcpy(s + g->gap_start, g->text + g->gap_end, len - g->gap_start);
+    s[len] = '\0';
+    return s;
+}
+
+size_t gap_word_left(const GapBuffer* g, size_t pos) {
+    while (pos > 0 && gap_at(g, pos - 1) == ' ') pos--;
+    while (pos > 0 && gap_at(g, pos - 1) != ' ') pos--;
+    return pos;
+}
+
+size_t gap_word_right(const GapBuffer* g, size_t pos) {
+    size_t len = gap_length(g);
+    while (pos < len && gap_at(g, pos) == ' ') pos++;
+    while (pos < len && gap_at(g, pos) != ' ') pos++;
+    return pos;
+}
+
+// ---------------------------------------------------------------------------
+// Screen model
+// ---------------------------------------------------------------------------
+
+void screen_init(Screen* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void screen_free(Screen* s) {
+    free(s->shown);
+    free(s->want);
+    screen_init(s);
+}
+
+static int grow(char **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return 1;
+    size_t n = *cap ? *cap : 128;
+    while (n < need) n *= 2;
+    char *p = realloc(*buf, n);
+    if (!p) return 0;
+    *buf = p;
+    *cap = n;
+    return 1;
+}
+
+static void emit_csi(size_t n, char op) {
+    char seq[32];
+    int len = n == 1 ? snprintf(seq, sizeof(seq), "\033[%c", op)
+                     : snprintf(seq, sizeof(seq), "\033[%zu%c", n, op);
+    term_write(seq, (size_t)len);
+}
+
+// Send cells [from, to) of the new frame, switching between the input and
+// ghost styles only where the kind of cell changes
+static void emit_cells(Screen *s, size_t from, size_t to, size_t ghost_start) {
+    for (size_t i = from; i < to; i++) {
+        int dim = i >= ghost_start;
+        if (dim != s->dim) {
+            term_puts(dim ? SCREEN_GHOST_STYLE : SCREEN_INPUT_STYLE);
+            s->dim = dim;
+        }
+        term_putc(s->want[i]);
+    }
+}
+
+// Move the terminal cursor to column `to`. Going right over cells that
+// are already correct, re-sending them is shorter than CUF.
+static void move_cursor(Screen *s, size_t to, size_t ghost_start) {
+    if (to < s->cursor) {
+        size_t n = s->cursor - to;
+        if (n <= SCREEN_SHORT_MOVE) {
+            for (size_t i = 0; i < n; i++) term_putc('\b');
+        } else {
+            emit_csi(n, 'D');
+        }
+    } else if (to > s->cursor) {
+        size_t n = to - s->cursor;
+        if (n <= SCREEN_SHORT_MOVE) {
+            emit_cells(s, s->cursor, to, ghost_start);
+        } else {
+            emit_csi(n, 'C');
+        }
+    }
+    s->cursor = to;
+}
+
+// The terminal shows the prompt followed by `shown`, with the cursor at
+// its end (what print_prompt leaves behind).
+void screen_reset(Screen* s, const char* shown, size_t len) {
+    s->shown_len = 0;
+    s->ghost_start = 0;
+    s->cursor = 0;
+    s->dim = 0;
+    if (!grow(&s->shown, &s->shown_cap, len + 1)) return;
+    memcpy(s->shown, shown, len);
+    s->shown_len = len;
+    s->ghost_start = len;
+    s->cursor = len;
+}
+
+void screen_render(Screen* s, const GapBuffer* g, const char* ghost) {
+    // The wanted row: the input, then the ghost text (drawn dimmed)
+    size_t in_len = gap_length(g);
+    size_t ghost_len = ghost ? strlen(ghost) : 0;
+    size_t n = in_len + ghost_len;
+    if (!grow(&s->want, &s->want_cap, n + 1)) return;
+    memcpy(s->want, g->text, g->gap_start);
+    memcpy(s->want + g->gap_start, g->text + g->gap_end, in_len - g->gap_start);
+    if (ghost_len) memcpy(s->want + in_len, ghost, ghost_len);
+
+    // Only the middle between the common prefix and common suffix differs.
+    // A cell matches when both its character and its style do.
+    size_t old = s->shown_len;
+    size_t og = s->ghost_start;
+#define SAME_CELL(i, j) (s->shown[i] == s->want[j] && ((i) >= og) == ((j) >= in_len))
+    size_t p = 0;
+    while (p < n && p < old && SAME_CELL(p, p)) p++;
+    size_t q = 0;
+    while (q < n - p && q < old - p && SAME_CELL(old - 1 - q, n - 1 - q)) q++;
+#undef SAME_CELL
+    size_t old_mid = old - p - q;
+    size_t new_mid = n - p - q;
+
+    if (old_mid > 0 || new_mid > 0) {
+        // A common suffix on screen is shifted with ICH/DCH instead of
+        // being redrawn; anything else rewrites from the first difference
+        move_cursor(s, p, in_len);
+        if (q > 0 && old_mid == new_mid) {
+            emit_cells(s, p, p + new_mid, in_len);
+            s->cursor = p + new_mid;
+        } else if (q > 0 && old_mid == 0) {
+            emit_csi(new_mid, '@');
+            emit_cells(s, p, p + new_mid, in_len);
+            s->cursor = p + new_mid;
+        } else if (q > 0 && new_mid == 0) {
+            emit_csi(old_mid, 'P');
+        } else {
+            emit_cells(s, p, n, in_len);
+            if (n < old) term_puts("\033[K");
+            s->cursor = n;
+        }
+    }
+
+    // Record what is on screen now, then place the cursor
+    if (grow(&s->shown, &s->shown_cap, n + 1)) {
+        memcpy(s->shown, s->want, n);
+        s->shown_len = n;
+        s->ghost_start = in_len;
+    }
+    move_cursor(s, g->gap_start, in_len);
+    if (s->dim) {
+        term_puts(SCREEN_INPUT_STYLE);
+        s->dim = 0;
+    }
+}
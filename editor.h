@@ -0,0 +1,65 @@
+#ifndef EDITOR_H
+#define EDITOR_H
+
+#include <stddef.h>
+#include "term.h"
+
+// Line-editing engine for ripple_read_line.
+//
+// GapBuffer holds the line being edited with the cursor at the gap, so
+// inserting or deleting at the cursor is O(1) and moving the cursor costs
+// only the distance moved.
+//
+// Screen remembers what the input part of the prompt currently shows and
+// where the terminal cursor is. screen_render() diffs the buffer against
+// that and queues only what changed (characters, ICH/DCH/EL, cursor moves)
+// in the term output buffer, which goes out with the rest of the frame.
+// Optional ghost text (an inline suggestion) is drawn dimmed after the
+// input. The row is assumed to fit on one terminal line.
+typedef struct {
+    char *text;
+    size_t cap;
+    size_t gap_start;      // == cursor position
+    size_t gap_end;
+} GapBuffer;
+
+void gap_init(GapBuffer* g);
+void gap_free(GapBuffer* g);
+size_t gap_length(const GapBuffer* g);
+char gap_at(const GapBuffer* g, size_t i);
+void gap_move(GapBuffer* g, size_t pos);
+int gap_insert(GapBuffer* g, const char* s, size_t n);
+void gap_delete_before(GapBuffer* g, size_t n);
+void gap_delete_after(GapBuffer* g, size_t n);
+int gap_set(GapBuffer* g, const char* s);
+const char* gap_text(GapBuffer* g);      // NUL-terminated; moves the cursor to the end
+char* gap_strdup(const GapBuffer* g);
+
+// Start of the word before pos / end of the word after pos (words are runs
+// of non-space characters)
+size_t gap_word_left(const GapBuffer* g, size_t pos);
+size_t gap_word_right(const GapBuffer* g, size_t pos);
+
+typedef struct {
+    char *shown;           // cells on screen: the input, then any ghost text
+    size_t shown_len;
+    size_t shown_cap;
+    size_t ghost_start;    // cells from here on are drawn dimmed
+    size_t cursor;         // terminal cursor, as a column within the row
+    char *want;            // scratch: the row the next frame should show
+    size_t want_cap;
+    int dim;               // ghost style is active (only inside a frame)
+} Screen;
+
+void screen_init(Screen* s);
+void screen_free(Screen* s);
+void screen_reset(Screen* s, const char* shown, size_t len);
+void screen_render(Screen* s, const GapBuffer* g, const char* ghost);
+
+// Constants
+#define GAP_INITIAL_SIZE 256
+#define SCREEN_SHORT_MOVE 3    // below this, plain bytes beat an escape sequence
+#define SCREEN_INPUT_STYLE TERM_GREEN
+#define SCREEN_GHOST_STYLE TERM_GHOST
+
+#endif // EDITOR_H
@@ -0,0 +1,123 @@
+#include "frecency.h"
+#include <stdint.h>
+#include <string.h>
+
+// Open-addressing table of fixed-size slots: one contiguous block, no
+// per-entry allocation, and a lookup touches one or two cache lines.
+typedef struct {
+    uint32_t hash;         // 0 = empty slot
+    unsigned int count;
+    time_t last;
+    unsigned long seq;
+    char name[FRECENCY_NAME_MAX];
+} FrecencySlot;
+
+static struct {
+    FrecencySlot slots[FRECENCY_SLOTS];
+    int used;
+    unsigned long seq;
+} g_frecency;
+
+static uint32_t frecency_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    for (; *s; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h ? h : 1;
+}
+
+static FrecencySlot *frecency_find(const char *cmd, uint32_t hash, int *found) {
+    uint32_t i = hash & (FRECENCY_SLOTS - 1);
+    for (;;) {
+        FrecencySlot *s = &g_frecency.slots[i];
+        if (s->hash == 0) {
+            *found = 0;
+            return s;
+        }
+        if (s->hash == hash && strcmp(s->name, cmd) == 0) {
+            *found = 1;
+            return s;
+        }
+        i = (i + 1) & (FRECENCY_SLOTS - 1);
+    }
+}
+
+// Halve every count and drop the commands that reach zero, so rarely used
+// commands make room and old habits fade. Repeats until below the fill limit.
+static void frecency_age(void) {
+    static FrecencySlot old[FRECENCY_SLOTS];
+
+    while (g_frecency.used >= FRECENCY_MAX_FILL) {
+        memcpy(old, g_frecency.slots, sizeof(old));
+        memset(g_frecency.slots, 0, sizeof(g_frecency.slots));
+        g_frecency.used = 0;
+
+        for (int i = 0; i < FRECENCY_SLOTS; i++) {
+            if (old[i].hash == 0 || old[i].count / 2 == 0) continue;
+            int found;
+            FrecencySlot *s = frecency_find(old[i].name, old[i].hash, &found);
+            *s = old[i];
+            s->count /= 2;
+            g_frecency.used++;
+        }
+    }
+}
+
+// Count one use of cmd; last == 0 marks a use replayed from history
+static void frecency_bump(const char *cmd, time_t last) {
+    if (!cmd || !*cmd || strlen(cmd) >= FRECENCY_NAME_MAX) return;
+
+    uint32_t hash = frecency_hash(cmd);
+    int found;
+    FrecencySlot *s = frecency_find(cmd, hash, &found);
+    if (!found) {
+        if (g_frecency.used + 1 >= FRECENCY_MAX_FILL) {
+            frecency_age();
+            s = frecency_find(cmd, hash, &found);
+        }
+        memset(s, 0, sizeof(*s));
+        s->hash = hash;
+        strcpy(s->name, cmd);
+        g_frecency.used++;
+    }
+    s->count++;
+    s->last = last;
+    s->seq = ++g_frecency.seq;
+}
+
+void frecency_record(const char* cmd) {
+    frecency_bump(cmd, time(NULL));
+}
+
+void frecency_seed(const char* cmd) {
+    frecency_bump(cmd, 0);
+}
+
+// Frequency weighted by age of the last use, in coarse buckets.
+void frecency_lookup(const char* cmd, Frecency* out) {
+    out->score = 0;
+    out->seq = 0;
+    if (!cmd || !*cmd || strlen(cmd) >= FRECENCY_NAME_MAX) return;
+
+    int found;
+    FrecencySlot *s = frecency_find(cmd, frecency_hash(cmd), &found);
+    if (!found) return;
+
+    double age = difftime(time(NULL), s->last);
+    double weight;
+    if (s->last == 0) weight = 1.0;     // seeded: some earlier session
+    else if (age < 3600) weight = 4.0;
+    else if (age < 86400) weight = 2.0;
+    else if (age < 7 * 86400) weight = 1.0;
+    else weight = 0.25;
+
+    out->score = s->count * weight;
+    out->seq = s->seq;
+}
+
+int frecency_compare(const Frecency* a, const Frecency* b) {
+    if (a->score != b->score) return a->score > b->score ? -1 : 1;
+    if (a->seq != b->seq) return a->seq > b->seq ? -1 : 1;
+    return 0;
+}
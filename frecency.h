@@ -0,0 +1,30 @@
+#ifndef FRECENCY_H
+#define FRECENCY_H
+
+#include <time.h>
+
+// Per-command usage counts for completion ranking ("frecency": how often a
+// command was run, weighted by how recently). Seeded from the loaded history
+// at startup, updated by ripple_execute and read by the completers; all on
+// the shell's main thread.
+typedef struct {
+    double score;          // 0 when the command was never run
+    unsigned long seq;     // order of the last use (higher = more recent)
+} Frecency;
+
+void frecency_record(const char* cmd);
+// A use from an earlier session, replayed from history at startup. It counts
+// like a recorded one, but its age is unknown and weighs as a past week's.
+void frecency_seed(const char* cmd);
+void frecency_lookup(const char* cmd, Frecency* out);
+
+// Rank a before b (<0), after b (>0) or tie (0): higher score first,
+// then the more recently used one.
+int frecency_compare(const Frecency* a, const Frecency* b);
+
+// Constants
+#define FRECENCY_SLOTS 512          // power of two
+#define FRECENCY_MAX_FILL 384       // age the table beyond this many commands
+#define FRECENCY_NAME_MAX 64
+
+#endif // FRECENCY_H
@@ -0,0 +1,108 @@
+#include "fuzzy.h"
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+// Scoring weights (same shape as fzf's)
+#define SCORE_MATCH 16
+#define SCORE_GAP_START (-3)
+#define SCORE_GAP_EXTENSION (-1)
+#define BONUS_BOUNDARY 8
+#define BONUS_CAMEL 7
+#define BONUS_CONSECUTIVE 4
+#define BONUS_FIRST_CHAR_MULTIPLIER 2
+#define BONUS_EXACT_CASE 1
+
+#define NEG_INF (INT_MIN / 2)
+
+// Bits 0-25 letters, 26-35 digits, 36-62 common punctuation, 63 the rest
+static int mask_bit(unsigned char c) {
+    c = (unsigned char)tolower(c);
+    if (c >= 'a' && c <= 'z') return c - 'a';
+    if (c >= '0' && c <= '9') return 26 + (c - '0');
+    static const char punct[] = " -_./:+@=,~";
+    const char *p = strchr(punct, c);
+    if (c && p) return 36 + (int)(p - punct);
+    return 63;
+}
+
+uint64_t fuzzy_charmask(const char* s) {
+    uint64_t mask = 0;
+    for (; s && *s; s++) {
+        mask |= 1ULL << mask_bit((unsigned char)*s);
+    }
+    return mask;
+}
+
+// Bonus for matching text[j], based on the character before it
+static int position_bonus(const char *text, int j) {
+    if (j == 0) return BONUS_BOUNDARY;
+    unsigned char prev = (unsigned char)text[j - 1];
+    unsigned char cur = (unsigned char)text[j];
+    if (!isalnum(prev) && isalnum(cur)) return BONUS_BOUNDARY;
+    if (islower(prev) && isupper(cur)) return BONUS_CAMEL;
+    if (isalpha(prev) && isdigit(cur)) return BONUS_CAMEL;
+    return 0;
+}
+
+// Best-alignment score via dynamic programming over (pattern, text).
+// row[j] holds the best score with the current pattern char matched at
+// text[j]; gaps are tracked with a running maximum so each row is O(n).
+int fuzzy_match(const char* pattern, const char* text, int* score) {
+    int m = (int)strlen(pattern);
+    int n = (int)strlen(text);
+    if (m == 0) {
+        if (score) *score = 0;
+        return 1;
+    }
+    if (m > FUZZY_MAX_PATTERN || n > FUZZY_MAX_TEXT || m > n) return 0;
+
+    // Quick subsequence check before paying for the DP
+    int k = 0;
+    for (int j = 0; j < n && k < m; j++) {
+        if (tolower((unsigned char)text[j]) == tolower((unsigned char)pattern[k])) k++;
+    }
+    if (k < m) return 0;
+
+    int bonus[FUZZY_MAX_TEXT];
+    for (int j = 0; j < n; j++) bonus[j] = position_bonus(text, j);
+
+    int prev_row[FUZZY_MAX_TEXT];
+    int row[FUZZY_MAX_TEXT];
+    for (int i = 0; i < m; i++) {
+        unsigned char pc = (unsigned char)pattern[i];
+        int best_gap = NEG_INF;
+        for (int j = 0; j < n; j++) {
+            int prev;
+            if (i == 0) {
+                prev = 0;
+            } else {
+                if (j >= 2) {
+                    int open = prev_row[j - 2] == NEG_INF ? NEG_INF : prev_row[j - 2] + SCORE_GAP_START;
+                    int extend = best_gap == NEG_INF ? NEG_INF : best_gap + SCORE_GAP_EXTENSION;
+                    best_gap = open > extend ? open : extend;
+                }
+                int diag = (j >= 1 && prev_row[j - 1] != NEG_INF) ? prev_row[j - 1] + BONUS_CONSECUTIVE : NEG_INF;
+                prev = diag > best_gap ? diag : best_gap;
+            }
+
+            unsigned char tc = (unsigned char)text[j];
+            if (prev == NEG_INF || tolower(tc) != tolower(pc)) {
+                row[j] = NEG_INF;
+                continue;
+            }
+            int s = SCORE_MATCH + (i == 0 ? bonus[j] * BONUS_FIRST_CHAR_MULTIPLIER : bonus[j]);
+            if (tc == pc) s += BONUS_EXACT_CASE;
+            row[j] = prev + s;
+        }
+        memcpy(prev_row, row, n * sizeof(int));
+    }
+
+    int best = NEG_INF;
+    for (int j = 0; j < n; j++) {
+        if (prev_row[j] > best) best = prev_row[j];
+    }
+    if (best == NEG_INF) return 0;
+    if (score) *score = best;
+    return 1;
+}
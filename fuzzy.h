@@ -0,0 +1,20 @@
+#ifndef FUZZY_H
+#define FUZZY_H
+
+#include <stdint.h>
+
+// fzf-style fuzzy matching: the pattern must appear in the text as a
+// (case-insensitive) subsequence; the score rewards consecutive runs and
+// matches at word boundaries and penalizes gaps.
+//
+// fuzzy_charmask() summarizes which characters a string contains. A text
+// can only match when its mask covers the pattern's mask, which lets
+// callers reject most candidates with one AND before scoring.
+uint64_t fuzzy_charmask(const char* s);
+int fuzzy_match(const char* pattern, const char* text, int* score);
+
+// Constants
+#define FUZZY_MAX_PATTERN 64
+#define FUZZY_MAX_TEXT 256
+
+#endif // FUZZY_H
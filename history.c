@@ -0,0 +1,559 @@
+#define _GNU_SOURCE   // memmem
+#include "history.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t off;      // into g_history.text
+    uint32_t len;      // without the terminating NUL
+} HistoryEntry;
+
+static struct {
+    HistoryEntry *ring;
+    size_t cap;        // ring slots allocated (grows up to HISTORY_MAX_ENTRIES)
+    size_t first;      // ring index of the oldest entry
+    size_t count;
+    char *text;        // NUL-terminated lines, oldest first
+    size_t used;
+    size_t size;
+    uint32_t serial;   // serial number of the oldest entry (never reused)
+} g_history;
+
+static void trigram_index_line(uint32_t serial, const char *line, size_t len);
+static void trigram_note_eviction(void);
+
+// Lines are evicted oldest first, so the live bytes are always the tail of
+// the buffer starting at the oldest entry. Slide them down to the front.
+static void history_compact(void) {
+    if (g_history.count == 0) {
+        g_history.used = 0;
+        return;
+    }
+    size_t base = g_history.ring[g_history.first].off;
+    if (base == 0) return;
+
+    memmove(g_history.text, g_history.text + base, g_history.used - base);
+    g_history.used -= base;
+    for (size_t i = 0; i < g_history.count; i++) {
+        g_history.ring[(g_history.first + i) % g_history.cap].off -= (uint32_t)base;
+    }
+}
+
+// Make room for need more bytes, compacting first when at least half the
+// buffer is dead so memory tracks what is actually kept.
+static int history_reserve(size_t need) {
+    if (g_history.count > 0) {
+        size_t dead = g_history.ring[g_history.first].off;
+        if (dead > 0 && (dead >= g_history.used / 2 || g_history.used + need > g_history.size)) {
+            history_compact();
+        }
+    } else {
+        g_history.used = 0;
+    }
+    if (g_history.used + need <= g_history.size) return 1;
+
+    size_t size = g_history.size ? g_history.size : HISTORY_INITIAL_BYTES;
+    while (size < g_history.used + need) size *= 2;
+    if (size > UINT32_MAX) return 0;
+    char *text = realloc(g_history.text, size);
+    if (!text) return 0;
+    g_history.text = text;
+    g_history.size = size;
+    return 1;
+}
+
+// Double the ring (until the cap), unwrapping it so the oldest entry is at 0.
+static int history_grow_ring(void) {
+    size_t cap = g_history.cap ? g_history.cap * 2 : 64;
+    if (cap > HISTORY_MAX_ENTRIES) cap = HISTORY_MAX_ENTRIES;
+
+    HistoryEntry *ring = malloc(cap * sizeof(HistoryEntry));
+    if (!ring) return 0;
+    for (size_t i = 0; i < g_history.count; i++) {
+        ring[i] = g_history.ring[(g_history.first + i) % g_history.cap];
+    }
+    free(g_history.ring);
+    g_history.ring = ring;
+    g_history.cap = cap;
+    g_history.first = 0;
+    return 1;
+}
+
+// Append len bytes of line to the in-memory ring only.
+static void history_push(const char *line, size_t len) {
+    if (g_history.count == g_history.cap && g_history.cap < HISTORY_MAX_ENTRIES) {
+        if (!history_grow_ring()) return;
+    }
+    if (g_history.count == g_history.cap) {
+        // Full: drop the oldest; its bytes become dead space
+        g_history.first = (g_history.first + 1) % g_history.cap;
+        g_history.count--;
+        g_history.serial++;
+        trigram_note_eviction();
+    }
+    if (!history_reserve(len + 1)) return;
+
+    HistoryEntry *e = &g_history.ring[(g_history.first + g_history.count) % g_history.cap];
+    e->off = (uint32_t)g_history.used;
+    e->len = (uint32_t)len;
+    memcpy(g_history.text + g_history.used, line, len);
+    g_history.text[g_history.used + len] = '\0';
+    g_history.used += len + 1;
+    trigram_index_line(g_history.serial + (uint32_t)g_history.count, line, len);
+    g_history.count++;
+}
+
+static void history_file_append(const char *line, size_t len);
+
+void history_add(const char* line) {
+    if (!line) return;
+    size_t len = strlen(line);
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    if (len == 0) return;
+
+    history_sync();            // others' commands go before ours
+    history_push(line, len);
+    history_file_append(line, len);
+}
+
+size_t history_count(void) {
+    return g_history.count;
+}
+
+const char* history_get(size_t i) {
+    if (i >= g_history.count) return NULL;
+    return g_history.text + g_history.ring[(g_history.first + i) % g_history.cap].off;
+}
+
+// ---------------------------------------------------------------------------
+// Reverse search. A trigram index maps every 3-byte substring to the
+// ascending list of entry serials containing it. A query reads the shortest
+// posting list among its trigrams from the newest end and confirms each
+// candidate with memmem, so the work is bounded by the rarest trigram rather
+// than the history size. The index is built on the first search and kept up
+// to date by history_push; evicted serials are skipped and dropped by a
+// rebuild once they outnumber the live entries.
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t key;      // three bytes + 1 (0 = empty slot)
+    uint32_t n;
+    uint32_t cap;
+    uint32_t *ids;     // serials, ascending
+} Posting;
+
+static struct {
+    Posting *slots;
+    size_t cap;        // power of two
+    size_t used;
+    size_t dead;       // evictions since the last build
+    int built;
+} g_trigrams;
+
+static uint32_t trigram_key(const char *p) {
+    return (((uint32_t)(unsigned char)p[0] << 16) |
+            ((uint32_t)(unsigned char)p[1] << 8) |
+            (uint32_t)(unsigned char)p[2]) + 1;
+}
+
+static Posting *trigram_slot(uint32_t key, int create) {
+    if (!g_trigrams.slots) return NULL;
+    size_t mask = g_trigrams.cap - 1;
+    size_t i = (key * 2654435761u) & mask;
+    while (g_trigrams.slots[i].key != 0) {
+        if (g_trigrams.slots[i].key == key) return &g_trigrams.slots[i];
+        i = (i + 1) & mask;
+    }
+    if (!create) return NULL;
+    g_trigrams.slots[i].key = key;
+    g_trigrams.used++;
+    return &g_trigrams.slots[i];
+}
+
+static void trigram_free(void) {
+    for (size_t i = 0; i < g_trigrams.cap; i++) free(g_trigrams.slots[i].ids);
+    free(g_trigrams.slots);
+    memset(&g_trigrams, 0, sizeof(g_trigrams));
+}
+
+static int trigram_grow(void) {
+    size_t cap = g_trigrams.cap ? g_trigrams.cap * 2 : 4096;
+    Posting *slots = calloc(cap, sizeof(Posting));
+    if (!slots) return 0;
+
+    Posting *old = g_trigrams.slots;
+    size_t old_cap = g_trigrams.cap;
+    g_trigrams.slots = slots;
+    g_trigrams.cap = cap;
+    g_trigrams.used = 0;
+    for (size_t i = 0; i < old_cap; i++) {
+        if (old[i].key == 0) continue;
+        *trigram_slot(old[i].key, 1) = old[i];
+    }
+    free(old);
+    return 1;
+}
+
+static void trigram_index_line(uint32_t serial, const char *line, size_t len) {
+    if (!g_trigrams.built) return;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        if ((g_trigrams.used + 1) * 4 > g_trigrams.cap * 3 && !trigram_grow()) return;
+        Posting *p = trigram_slot(trigram_key(line + i), 1);
+        if (p->n > 0 && p->ids[p->n - 1] == serial) continue;   // repeated in this line
+        if (p->n == p->cap) {
+            uint32_t cap = p->cap ? p->cap * 2 : 4;
+            uint32_t *ids = realloc(p->ids, cap * sizeof(uint32_t));
+            if (!ids) return;
+            p->ids = ids;
+            p->cap = cap;
+        }
+        p->ids[p->n++] = serial;
+    }
+}
+
+static void trigram_note_eviction(void) {
+    if (g_trigrams.built) g_trigrams.dead++;
+}
+
+static int trigram_build(void) {
+    trigram_free();
+    if (!trigram_grow()) return 0;
+    g_trigrams.built = 1;
+    for (size_t i = 0; i < g_history.count; i++) {
+        const HistoryEntry *e = &g_history.ring[(g_history.first + i) % g_history.cap];
+        trigram_index_line(g_history.serial + (uint32_t)i, g_history.text + e->off, e->len);
+    }
+    return 1;
+}
+
+static int history_entry_contains(size_t i, const char *query, size_t qlen) {
+    const HistoryEntry *e = &g_history.ring[(g_history.first + i) % g_history.cap];
+    return memmem(g_history.text + e->off, e->len, query, qlen) != NULL;
+}
+
+// Newest entry before index `before` whose line contains query, or -1.
+long history_search(const char* query, size_t before) {
+    size_t qlen = query ? strlen(query) : 0;
+    if (before > g_history.count) before = g_history.count;
+    if (qlen == 0 || before == 0) return -1;
+
+    if (qlen < 3) {
+        // Too short for a trigram; such queries match something recent
+        for (size_t i = before; i-- > 0; ) {
+            if (history_entry_contains(i, query, qlen)) return (long)i;
+        }
+        return -1;
+    }
+
+    if (!g_trigrams.built || g_trigrams.dead > g_history.count) {
+        if (!trigram_build()) return -1;
+    }
+
+    const Posting *best = NULL;
+    for (size_t i = 0; i + 3 <= qlen; i++) {
+        const Posting *p = trigram_slot(trigram_key(query + i), 0);
+        if (!p) return -1;
+        if (!best || p->n < best->n) best = p;
+    }
+
+    // Start at the last serial below `before`, then walk towards older ones
+    uint32_t limit = g_history.serial + (uint32_t)before;
+    size_t lo = 0, hi = best->n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (best->ids[mid] < limit) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t k = lo; k-- > 0; ) {
+        uint32_t serial = best->ids[k];
+        if (serial < g_history.serial) break;             // evicted
+        size_t i = serial - g_history.serial;
+        if (history_entry_contains(i, query, qlen)) return (long)i;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// History file. Layout: the 8-byte magic, then one record per command:
+//   uint32_t len (host order) | len bytes of the line | '\n'
+// The trailing newline doubles as a check against a torn final record.
+// ---------------------------------------------------------------------------
+
+#define HISTORY_MAGIC_LEN (sizeof(HISTORY_FILE_MAGIC) - 1)
+#define HISTORY_OWN_WRITES 16
+
+static struct {
+    int fd;
+    char path[1024];
+    off_t pos;                                 // end of what we have merged
+    off_t own[HISTORY_OWN_WRITES];             // start offsets of our records
+    int own_next;
+    int share;                                 // merge other shells' commands
+} g_histfile = { .fd = -1 };
+
+static int history_file_path(char *out, size_t out_sz) {
+    const char *env = getenv("RIPPLE_HISTFILE");
+    if (env && *env) {
+        snprintf(out, out_sz, "%s", env);
+        return 1;
+    }
+    const char *home = getenv("HOME");
+    if (!home || !*home) return 0;
+    snprintf(out, out_sz, "%s/%s", home, HISTORY_FILE_NAME);
+    return 1;
+}
+
+// Length of the valid record at p (0 when it is torn or corrupt).
+static size_t history_record_at(const char *p, const char *end) {
+    uint32_t len;
+    if ((size_t)(end - p) < sizeof(len) + 1) return 0;
+    memcpy(&len, p, sizeof(len));
+    if (len == 0 || len > HISTORY_RECORD_MAX) return 0;
+    if ((size_t)(end - p) < sizeof(len) + len + 1) return 0;
+    if (p[sizeof(len) + len] != '\n') return 0;
+    return sizeof(len) + len + 1;
+}
+
+// First valid record at or after p, or NULL; *n gets its length. A record
+// torn by a full disk or a crash mid-write is stepped over rather than
+// taken for the end of the file, so what other writes appended after it is
+// still loaded. Lines never contain NUL bytes and a valid length always
+// does, so no false record can start inside one.
+static const char *history_next_record(const char *p, const char *end, size_t *n) {
+    for (; p < end; p++) {
+        *n = history_record_at(p, end);
+        if (*n) return p;
+    }
+    return NULL;
+}
+
+static int history_is_own(off_t off) {
+    for (int i = 0; i < HISTORY_OWN_WRITES; i++) {
+        if (g_histfile.own[i] == off) return 1;
+    }
+    return 0;
+}
+
+// Push the records in [start, end) of the mapped file. Only the last
+// HISTORY_MAX_ENTRIES can survive in the ring, so the walk just finds where
+// they begin and copies from there. Returns the offset after the last valid
+// record and the number of records seen. Damaged bytes after that offset
+// are looked at again next time, in case they are a record still being
+// written.
+static off_t history_load_range(const char *map, off_t start, off_t end, size_t *records) {
+    const char *p = map + start;
+    const char *stop = map + end;
+    const char *last_end = p;
+    size_t seen = 0;
+    size_t n;
+    const char *keep = p;
+    const char *keep_ring[128];
+    size_t stride = HISTORY_MAX_ENTRIES / 64;
+
+    // Remember every stride-th record start so the copy can begin at most
+    // one stride before the last HISTORY_MAX_ENTRIES records.
+    while ((p = history_next_record(p, stop, &n)) != NULL) {
+        if (seen % stride == 0) keep_ring[(seen / stride) % 128] = p;
+        seen++;
+        p += n;
+        last_end = p;
+    }
+    stop = last_end;
+    if (seen > HISTORY_MAX_ENTRIES) {
+        size_t skip = (seen - HISTORY_MAX_ENTRIES) / stride;
+        keep = keep_ring[skip % 128];
+    }
+
+    for (p = keep; (p = history_next_record(p, stop, &n)) != NULL; ) {
+        uint32_t len;
+        memcpy(&len, p, sizeof(len));
+        if (!g_histfile.share || !history_is_own((off_t)(p - map))) {
+            history_push(p + sizeof(len), len);
+        }
+        p += n;
+    }
+    if (records) *records = seen;
+    return (off_t)(stop - map);
+}
+
+// Rewrite the file with only the newest HISTORY_MAX_ENTRIES records. Other
+// shells hold LOCK_SH while appending and reopen the file when its inode
+// changes, so no record is written to the unlinked copy.
+static void history_file_trim(void) {
+    if (flock(g_histfile.fd, LOCK_EX) != 0) return;
+
+    // Serialize the ring into one buffer so the rewrite is a single write
+    size_t n = history_count();
+    size_t size = HISTORY_MAGIC_LEN;
+    for (size_t i = 0; i < n; i++) {
+        size += sizeof(uint32_t) + g_history.ring[(g_history.first + i) % g_history.cap].len + 1;
+    }
+    char *buf = malloc(size);
+    if (!buf) {
+        flock(g_histfile.fd, LOCK_UN);
+        return;
+    }
+    char *w = buf;
+    memcpy(w, HISTORY_FILE_MAGIC, HISTORY_MAGIC_LEN);
+    w += HISTORY_MAGIC_LEN;
+    for (size_t i = 0; i < n; i++) {
+        const HistoryEntry *e = &g_history.ring[(g_history.first + i) % g_history.cap];
+        memcpy(w, &e->len, sizeof(e->len));
+        memcpy(w + sizeof(e->len), g_history.text + e->off, e->len);
+        w[sizeof(e->len) + e->len] = '\n';
+        w += sizeof(e->len) + e->len + 1;
+    }
+
+    char tmp[1100];
+    snprintf(tmp, sizeof(tmp), "%s.tmp.%ld", g_histfile.path, (long)getpid());
+    int out = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (out >= 0) {
+        int ok = write(out, buf, size) == (ssize_t)size;
+        if (close(out) == 0 && ok && rename(tmp, g_histfile.path) == 0) {
+            int fd = open(g_histfile.path, O_RDWR | O_APPEND | O_CLOEXEC);
+            if (fd >= 0) {
+                flock(g_histfile.fd, LOCK_UN);
+                close(g_histfile.fd);
+                g_histfile.fd = fd;
+                g_histfile.pos = lseek(fd, 0, SEEK_END);
+                free(buf);
+                return;
+            }
+        } else {
+            unlink(tmp);
+        }
+    }
+    flock(g_histfile.fd, LOCK_UN);
+    free(buf);
+}
+
+// Open (creating if needed) and load the history file.
+int history_open(void) {
+    if (g_histfile.fd >= 0) return 1;
+    if (!history_file_path(g_histfile.path, sizeof(g_histfile.path))) return 0;
+
+    const char *share = getenv("RIPPLE_SHARE_HISTORY");
+    g_histfile.share = share && *share && strcmp(share, "0") != 0;
+    for (int i = 0; i < HISTORY_OWN_WRITES; i++) g_histfile.own[i] = -1;
+
+    int fd = open(g_histfile.path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) return 0;
+    g_histfile.fd = fd;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        history_close();
+        return 0;
+    }
+    if (st.st_size == 0) {
+        // New file: the magic goes in with the first (and only) write
+        flock(fd, LOCK_EX);
+        if (fstat(fd, &st) == 0 && st.st_size == 0) {
+            if (write(fd, HISTORY_FILE_MAGIC, HISTORY_MAGIC_LEN) != (ssize_t)HISTORY_MAGIC_LEN) {
+                flock(fd, LOCK_UN);
+                history_close();
+                return 0;
+            }
+        }
+        flock(fd, LOCK_UN);
+        fstat(fd, &st);
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+        history_close();
+        return 0;
+    }
+    if ((size_t)st.st_size < HISTORY_MAGIC_LEN ||
+        memcmp(map, HISTORY_FILE_MAGIC, HISTORY_MAGIC_LEN) != 0) {
+        // Not ours: leave it alone and keep history in memory only
+        munmap(map, (size_t)st.st_size);
+        history_close();
+        return 0;
+    }
+
+    size_t records = 0;
+    g_histfile.pos = history_load_range(map, HISTORY_MAGIC_LEN, st.st_size, &records);
+    munmap(map, (size_t)st.st_size);
+
+    if (records > HISTORY_FILE_MAX_RECORDS) history_file_trim();
+    return 1;
+}
+
+// Reopen the file when another shell has trimmed (replaced) it.
+static void history_file_reopen_if_replaced(void) {
+    struct stat a, b;
+    if (fstat(g_histfile.fd, &a) != 0 || stat(g_histfile.path, &b) != 0) return;
+    if (a.st_ino == b.st_ino && a.st_dev == b.st_dev) return;
+
+    int fd = open(g_histfile.path, O_RDWR | O_APPEND | O_CLOEXEC);
+    if (fd < 0) return;
+    close(g_histfile.fd);
+    g_histfile.fd = fd;
+    // Everything before the current end was written by the trimmer from its
+    // own view of history; only merge what comes after it
+    g_histfile.pos = lseek(fd, 0, SEEK_END);
+}
+
+// One write() per command, so O_APPEND keeps records from several shells whole.
+static void history_file_append(const char *line, size_t len) {
+    if (g_histfile.fd < 0 || len > HISTORY_RECORD_MAX) return;
+
+    char stack[512];
+    size_t total = sizeof(uint32_t) + len + 1;
+    char *rec = total <= sizeof(stack) ? stack : malloc(total);
+    if (!rec) return;
+    uint32_t len32 = (uint32_t)len;
+    memcpy(rec, &len32, sizeof(len32));
+    memcpy(rec + sizeof(len32), line, len);
+    rec[total - 1] = '\n';
+
+    if (flock(g_histfile.fd, LOCK_SH) == 0) {
+        history_file_reopen_if_replaced();
+        if (write(g_histfile.fd, rec, total) == (ssize_t)total) {
+            off_t end = lseek(g_histfile.fd, 0, SEEK_CUR);
+            if (end >= (off_t)total) {
+                off_t start = end - (off_t)total;
+                if (start == g_histfile.pos) {
+                    g_histfile.pos = end;         // nobody else wrote since
+                } else {
+                    // Other records came first; history_sync merges them
+                    // and skips this one
+                    g_histfile.own[g_histfile.own_next] = start;
+                    g_histfile.own_next = (g_histfile.own_next + 1) % HISTORY_OWN_WRITES;
+                }
+            }
+        }
+        flock(g_histfile.fd, LOCK_UN);
+    }
+
+    if (rec != stack) free(rec);
+}
+
+// Merge commands other shells appended since the last look. Only active
+// with RIPPLE_SHARE_HISTORY set; costs one fstat when nothing changed.
+void history_sync(void) {
+    if (g_histfile.fd < 0 || !g_histfile.share) return;
+
+    history_file_reopen_if_replaced();
+    struct stat st;
+    if (fstat(g_histfile.fd, &st) != 0 || st.st_size <= g_histfile.pos) return;
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, g_histfile.fd, 0);
+    if (map == MAP_FAILED) return;
+    g_histfile.pos = history_load_range(map, g_histfile.pos, st.st_size, NULL);
+    munmap(map, (size_t)st.st_size);
+}
+
+void history_close(void) {
+    if (g_histfile.fd >= 0) close(g_histfile.fd);
+    g_histfile.fd = -1;
+}
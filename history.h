@@ -0,0 +1,38 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stddef.h>
+
+// Command history: a bounded ring of (offset, length) records pointing into
+// one growable string buffer that holds the full command lines back to back.
+// Appending is O(1) amortized with no allocation per entry; once the ring is
+// full the oldest line is dropped and its bytes are reclaimed on the next
+// compaction.
+//
+// With history_open() the history also persists in ~/.ripple_history (or
+// $RIPPLE_HISTFILE). Each command is one O_APPEND write of a length-prefixed
+// record, so concurrent shells never interleave, and startup maps the file
+// and walks the records instead of parsing lines.
+void history_add(const char* line);
+size_t history_count(void);
+
+// i = 0 is the oldest line. The pointer stays valid until the next add.
+const char* history_get(size_t i);
+
+// Reverse search: index of the newest line before `before` that contains
+// query, or -1. Lookups go through a trigram index over the history.
+long history_search(const char* query, size_t before);
+
+int history_open(void);
+void history_sync(void);
+void history_close(void);
+
+// Constants
+#define HISTORY_MAX_ENTRIES 100000
+#define HISTORY_INITIAL_BYTES 4096
+#define HISTORY_FILE_NAME ".ripple_history"
+#define HISTORY_FILE_MAGIC "RPLHIST1"
+#define HISTORY_FILE_MAX_RECORDS (2 * HISTORY_MAX_ENTRIES)  // trimmed beyond this
+#define HISTORY_RECORD_MAX 65536
+
+#endif // HISTORY_H
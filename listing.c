@@ -0,0 +1,442 @@
+#define _GNU_SOURCE   // statx
+#include "listing.h"
+#include "arena.h"
+#include "dir_iter.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <time.h>
+#include <pwd.h>
+#include <grp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LISTING_STAT_BATCH 256          // entries a stat worker claims at once
+#define LISTING_ID_CACHE 32             // distinct owners/groups remembered
+#define LISTING_SIX_MONTHS (182L * 24 * 60 * 60)
+
+typedef struct {
+    const char *name;       // in the listing's arena
+    uint64_t key;           // first 8 bytes, big-endian; settles most compares
+    size_t len;
+    size_t width;           // terminal columns the name takes
+    // -l only, filled in by stat_entry()
+    int stat_ok;
+    mode_t mode;
+    nlink_t nlink;
+    uid_t uid;
+    gid_t gid;
+    off_t size;
+    time_t mtime;
+    const char *owner;
+    const char *group;
+} ListEntry;
+
+// Output assembled in memory and written once at the end
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;
+} OutBuf;
+
+typedef struct {
+    ListEntry *items;
+    size_t count;
+    int dir_fd;
+    atomic_size_t next;
+} StatJob;
+
+typedef struct {
+    unsigned int id;
+    const char *name;
+} IdName;
+
+static int out_reserve(OutBuf *b, size_t n) {
+    if (b->failed) return 0;
+    if (b->len + n <= b->cap) return 1;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) {
+        b->failed = 1;
+        return 0;
+    }
+    b->data = data;
+    b->cap = cap;
+    return 1;
+}
+
+static void out_append(OutBuf *b, const char *s, size_t n) {
+    if (!out_reserve(b, n)) return;
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+static void out_spaces(OutBuf *b, size_t n) {
+    if (!out_reserve(b, n)) return;
+    memset(b->data + b->len, ' ', n);
+    b->len += n;
+}
+
+static void out_printf(OutBuf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void out_printf(OutBuf *b, const char *fmt, ...) {
+    if (!out_reserve(b, 128)) return;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= b->cap - b->len) {
+        if (!out_reserve(b, (size_t)n + 1)) return;
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len += (size_t)n;
+}
+
+static int out_write(OutBuf *b) {
+    if (b->failed) {
+        errno = ENOMEM;
+        return -1;
+    }
+    // Anything printed with stdio before the listing goes first
+    fflush(stdout);
+    size_t done = 0;
+    while (done < b->len) {
+        ssize_t n = write(STDOUT_FILENO, b->data + done, b->len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+static uint64_t sort_key(const char *name, size_t len) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < 8; i++) {
+        key = (key << 8) | (i < len ? (unsigned char)name[i] : 0);
+    }
+    return key;
+}
+
+// strcmp order: equal keys mean equal first 8 bytes, and both names are at
+// least 8 long unless they are the same name
+static int compare_entries(const void *a, const void *b) {
+    const ListEntry *x = a;
+    const ListEntry *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    if (x->len < 8) return 0;
+    return strcmp(x->name + 8, y->name + 8);
+}
+
+// UTF-8 continuation bytes do not take a column of their own
+static size_t display_width(const char *s, size_t len) {
+    size_t width = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (((unsigned char)s[i] & 0xC0) != 0x80) width++;
+    }
+    return width;
+}
+
+static void stat_entry(int dir_fd, ListEntry *e) {
+#ifdef STATX_TYPE
+    struct statx sx;
+    unsigned int mask = STATX_TYPE | STATX_MODE | STATX_NLINK | STATX_UID |
+                        STATX_GID | STATX_SIZE | STATX_MTIME;
+    if (statx(dir_fd, e->name, AT_SYMLINK_NOFOLLOW, mask, &sx) == 0) {
+        e->mode = sx.stx_mode;
+        e->nlink = sx.stx_nlink;
+        e->uid = sx.stx_uid;
+        e->gid = sx.stx_gid;
+        e->size = (off_t)sx.stx_size;
+        e->mtime = (time_t)sx.stx_mtime.tv_sec;
+        e->stat_ok = 1;
+        return;
+    }
+    if (errno != ENOSYS) return;
+#endif
+    struct stat st;
+    if (fstatat(dir_fd, e->name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        e->mode = st.st_mode;
+        e->nlink = st.st_nlink;
+        e->uid = st.st_uid;
+        e->gid = st.st_gid;
+        e->size = st.st_size;
+        e->mtime = st.st_mtime;
+        e->stat_ok = 1;
+    }
+}
+
+static void *stat_worker(void *arg) {
+    StatJob *job = arg;
+    for (;;) {
+        size_t start = atomic_fetch_add(&job->next, LISTING_STAT_BATCH);
+        if (start >= job->count) break;
+        size_t end = start + LISTING_STAT_BATCH;
+        if (end > job->count) end = job->count;
+        for (size_t i = start; i < end; i++) {
+            stat_entry(job->dir_fd, &job->items[i]);
+        }
+    }
+    return NULL;
+}
+
+// Stat every entry; big directories are shared out between threads in
+// batches, which keeps several metadata lookups in flight on slow disks
+static void stat_all(ListEntry *items, size_t count, int dir_fd) {
+    StatJob job;
+    job.items = items;
+    job.count = count;
+    job.dir_fd = dir_fd;
+    atomic_init(&job.next, 0);
+
+    int threads = 1;
+    if (count >= LISTING_PARALLEL_MIN) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+        if (threads > LISTING_MAX_THREADS) threads = LISTING_MAX_THREADS;
+    }
+
+    pthread_t tids[LISTING_MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&tids[started], NULL, stat_worker, &job) == 0) started++;
+    }
+    stat_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(tids[i], NULL);
+    }
+}
+
+// Owner and group names, looked up once per id (main thread only)
+static const char *id_name(IdName *cache, size_t *cached, Arena *arena,
+                           unsigned int id, int is_group) {
+    for (size_t i = 0; i < *cached; i++) {
+        if (cache[i].id == id) return cache[i].name;
+    }
+    const char *found = NULL;
+    if (is_group) {
+        struct group *gr = getgrgid((gid_t)id);
+        if (gr) found = gr->gr_name;
+    } else {
+        struct passwd *pw = getpwuid((uid_t)id);
+        if (pw) found = pw->pw_name;
+    }
+    char number[16];
+    if (!found) {
+        snprintf(number, sizeof(number), "%u", id);
+        found = number;
+    }
+    const char *name = arena_strdup(arena, found);
+    if (!name) return "?";
+    if (*cached < LISTING_ID_CACHE) {
+        cache[*cached].id = id;
+        cache[*cached].name = name;
+        (*cached)++;
+    }
+    return name;
+}
+
+static void format_mode(mode_t mode, char out[11]) {
+    out[0] = S_ISDIR(mode) ? 'd' : S_ISLNK(mode) ? 'l' : S_ISCHR(mode) ? 'c' :
+             S_ISBLK(mode) ? 'b' : S_ISFIFO(mode) ? 'p' : S_ISSOCK(mode) ? 's' : '-';
+    out[1] = (mode & S_IRUSR) ? 'r' : '-';
+    out[2] = (mode & S_IWUSR) ? 'w' : '-';
+    out[3] = (mode & S_ISUID) ? ((mode & S_IXUSR) ? 's' : 'S') : ((mode & S_IXUSR) ? 'x' : '-');
+    out[4] = (mode & S_IRGRP) ? 'r' : '-';
+    out[5] = (mode & S_IWGRP) ? 'w' : '-';
+    out[6] = (mode & S_ISGID) ? ((mode & S_IXGRP) ? 's' : 'S') : ((mode & S_IXGRP) ? 'x' : '-');
+    out[7] = (mode & S_IROTH) ? 'r' : '-';
+    out[8] = (mode & S_IWOTH) ? 'w' : '-';
+    out[9] = (mode & S_ISVTX) ? ((mode & S_IXOTH) ? 't' : 'T') : ((mode & S_IXOTH) ? 'x' : '-');
+    out[10] = '\0';
+}
+
+static int digits(unsigned long long n) {
+    int d = 1;
+    while (n >= 10) {
+        n /= 10;
+        d++;
+    }
+    return d;
+}
+
+// mode links owner group size mtime name [-> target], columns aligned
+static void layout_long(OutBuf *b, ListEntry *items, size_t count, int dir_fd, Arena *arena) {
+    IdName users[LISTING_ID_CACHE], groups[LISTING_ID_CACHE];
+    size_t nusers = 0, ngroups = 0;
+    int links_w = 1, size_w = 1;
+    size_t owner_w = 1, group_w = 1;
+    for (size_t i = 0; i < count; i++) {
+        ListEntry *e = &items[i];
+        if (!e->stat_ok) continue;
+        e->owner = id_name(users, &nusers, arena, (unsigned int)e->uid, 0);
+        e->group = id_name(groups, &ngroups, arena, (unsigned int)e->gid, 1);
+        int w = digits((unsigned long long)e->nlink);
+        if (w > links_w) links_w = w;
+        w = digits((unsigned long long)e->size);
+        if (w > size_w) size_w = w;
+        if (strlen(e->owner) > owner_w) owner_w = strlen(e->owner);
+        if (strlen(e->group) > group_w) group_w = strlen(e->group);
+    }
+
+    time_t now = time(NULL);
+    for (size_t i = 0; i < count; i++) {
+        ListEntry *e = &items[i];
+        if (!e->stat_ok) {
+            out_printf(b, "?????????? %s\n", e->name);
+            continue;
+        }
+        char mode[11];
+        format_mode(e->mode, mode);
+        char when[32];
+        struct tm tm;
+        localtime_r(&e->mtime, &tm);
+        int recent = e->mtime <= now && now - e->mtime < LISTING_SIX_MONTHS;
+        strftime(when, sizeof(when), recent ? "%b %e %H:%M" : "%b %e  %Y", &tm);
+
+        out_printf(b, "%s %*llu %-*s %-*s %*lld %s %s", mode,
+                   links_w, (unsigned long long)e->nlink,
+                   (int)owner_w, e->owner, (int)group_w, e->group,
+                   size_w, (long long)e->size, when, e->name);
+        if (S_ISLNK(e->mode)) {
+            char target[PATH_MAX];
+            ssize_t n = readlinkat(dir_fd, e->name, target, sizeof(target) - 1);
+            if (n >= 0) {
+                out_append(b, " -> ", 4);
+                out_append(b, target, (size_t)n);
+            }
+        }
+        out_append(b, "\n", 1);
+    }
+}
+
+// Column-major layout like ls -C: the most columns whose widest names
+// still fit in width
+static void layout_columns(OutBuf *b, const ListEntry *items, size_t count, size_t width) {
+    if (count == 0) return;
+    size_t max_cols = width / (1 + LISTING_COLUMN_GAP);
+    if (max_cols > count) max_cols = count;
+    size_t *col_w = max_cols > 1 ? malloc(max_cols * sizeof(size_t)) : NULL;
+
+    size_t cols = 1, rows = count;
+    for (size_t c = max_cols; c > 1 && col_w; c--) {
+        size_t r = (count + c - 1) / c;
+        size_t used = (count + r - 1) / r;  // the last columns may be empty
+        size_t total = 0;
+        int fits = 1;
+        for (size_t col = 0; col < used && fits; col++) {
+            size_t w = 0;
+            size_t end = (col + 1) * r < count ? (col + 1) * r : count;
+            for (size_t i = col * r; i < end; i++) {
+                if (items[i].width > w) w = items[i].width;
+            }
+            col_w[col] = w;
+            total += w + (col + 1 < used ? LISTING_COLUMN_GAP : 0);
+            if (total > width) fits = 0;
+        }
+        if (fits) {
+            cols = used;
+            rows = r;
+            break;
+        }
+    }
+
+    for (size_t row = 0; row < rows; row++) {
+        for (size_t col = 0; col < cols; col++) {
+            size_t i = col * rows + row;
+            if (i >= count) break;
+            out_append(b, items[i].name, items[i].len);
+            if (col + 1 < cols && i + rows < count) {
+                out_spaces(b, col_w[col] - items[i].width + LISTING_COLUMN_GAP);
+            }
+        }
+        out_append(b, "\n", 1);
+    }
+    free(col_w);
+}
+
+static ListEntry *add_entry(ListEntry **items, size_t *count, size_t *cap) {
+    if (*count == *cap) {
+        size_t new_cap = *cap ? *cap * 2 : 256;
+        ListEntry *temp = realloc(*items, new_cap * sizeof(ListEntry));
+        if (!temp) return NULL;
+        *items = temp;
+        *cap = new_cap;
+    }
+    ListEntry *e = &(*items)[(*count)++];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+static void set_name(ListEntry *e, const char *name, size_t len) {
+    e->name = name;
+    e->len = len;
+    e->key = sort_key(name, len);
+    e->width = display_width(name, len);
+}
+
+int list_path(const char* path, const ListOptions* opt) {
+    Arena arena;
+    arena_init(&arena, 0);
+    ListEntry *items = NULL;
+    size_t count = 0, cap = 0;
+    int dir_fd = AT_FDCWD;
+
+    DirIter it;
+    if (dir_iter_open(&it, AT_FDCWD, path, NULL, 0) == 0) {
+        DirEntry entry;
+        while (dir_iter_next(&it, &entry) > 0) {
+            if (!opt->all && entry.name[0] == '.') continue;
+            char *name = arena_strndup(&arena, entry.name, entry.name_len);
+            ListEntry *e = name ? add_entry(&items, &count, &cap) : NULL;
+            if (!e) break;
+            set_name(e, name, entry.name_len);
+        }
+        // Kept for statx()/readlinkat() on the entries
+        dir_fd = dir_iter_take_fd(&it);
+        dir_iter_close(&it);
+    } else if (errno == ENOTDIR) {
+        // A file on its own is listed under the name it was given
+        ListEntry *e = add_entry(&items, &count, &cap);
+        if (e) set_name(e, path, strlen(path));
+    } else {
+        arena_free(&arena);
+        return -1;
+    }
+
+    if (count > 1) qsort(items, count, sizeof(ListEntry), compare_entries);
+
+    OutBuf out = { NULL, 0, 0, 0 };
+    if (opt->long_format) {
+        stat_all(items, count, dir_fd);
+        layout_long(&out, items, count, dir_fd, &arena);
+    } else if (opt->width > 0) {
+        layout_columns(&out, items, count, (size_t)opt->width);
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            out_append(&out, items[i].name, items[i].len);
+            out_append(&out, "\n", 1);
+        }
+    }
+    int result = out_write(&out);
+    int err = errno;
+
+    if (dir_fd != AT_FDCWD) close(dir_fd);
+    free(out.data);
+    free(items);
+    arena_free(&arena);
+    errno = err;
+    return result;
+}
@@ -0,0 +1,26 @@
+#ifndef LISTING_H
+#define LISTING_H
+
+// Directory listing engine behind the ls builtin.
+// Entries are read with dir_iter into an arena, sorted by byte value
+// (strcmp order, whatever the locale) and laid out either in columns that
+// fit the terminal, one per line, or in a long format. The long format
+// asks statx() only for the fields it prints, spread over several threads
+// on big directories. The whole listing is assembled in memory and written
+// to stdout with one write().
+typedef struct {
+    int all;            // -a: include names starting with '.'
+    int long_format;    // -l: mode, links, owner, group, size, mtime
+    int width;          // terminal columns; 0 prints one name per line
+} ListOptions;
+
+// List a directory, or a single entry when path is not a directory.
+// Returns 0, or -1 with errno set.
+int list_path(const char* path, const ListOptions* opt);
+
+// Constants
+#define LISTING_COLUMN_GAP 2            // spaces between columns
+#define LISTING_PARALLEL_MIN 4096       // entries before -l stats go parallel
+#define LISTING_MAX_THREADS 16
+
+#endif // LISTING_H
@@ -1,4 +1,12 @@
 #include "ollama_integration.h"
+#include "ai_cache.h"
+#include "path_index.h"
+#include "arena.h"
+#include "fuzzy.h"
+#include "frecency.h"
+#include "term.h"
+#include "history.h"
+#include "builtins.h"
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -14,23 +22,14 @@
 #include <curl/curl.h>
 #include <json-c/json.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
 
 // Constants
 #define RIPPLE_RL_BUFSIZE 1024
-#define RIPPLE_TOK_BUFSIZE 64
-#define RIPPLE_TOK_DELIM " \t\r\n\a"
 #define RIPPLE_VERSION "1.0.0"
 #define OLLAMA_API_URL "http://localhost:11434/api/generate"
-
-typedef struct {
-    const char *name;
-    const char *summary;
-    const char *what;
-    const char *usage;
-    const char *examples; // multiline
-    const char *common;   // multiline (tables/bullets)
-    const char *related;  // comma-separated
-} BuiltinHelp;
+#define OLLAMA_MODEL "tinyllama"
 
 typedef struct {
     const char *flag;
@@ -64,245 +63,6 @@ static const FlagHelp GCC_FLAGS[] = {
     {"-pthread", "Enable pthreads (compile+link)"},
 };
 
-static const BuiltinHelp BUILTIN_HELP[] = {
-    {
-        "cd",
-        "Change directory (move between folders)",
-        "The cd command stands for Change Directory.\nIt changes your current working directory in the shell (moves you from one folder to another).",
-        "cd <directory>\ncd\ncd ~",
-        "Examples:\n"
-        "  cd Documents\n"
-        "  cd ..\n"
-        "  cd /tmp\n",
-        "Common cd forms:\n"
-        "  cd /        - Go to the root directory\n"
-        "  cd ~ or cd  - Go to your home directory\n"
-        "  cd ..       - Move one level up (parent directory)\n"
-        "  cd ../..    - Move two levels up\n"
-        "  cd -        - Go back to the previous directory (note: not implemented in this shell)\n",
-        "pwd, ls, tree"
-    },
-    {
-        "help",
-        "Show available built-in commands",
-        "Prints a list of the built-in commands supported by this shell.",
-        "help",
-        "Examples:\n"
-        "  help\n",
-        "Tip:\n"
-        "  Use TAB on a command name (e.g., 'cd' then TAB) to see detailed help.\n",
-        "version, history, pwd"
-    },
-    {
-        "exit",
-        "Exit the shell",
-        "Exits the shell program and returns you to your normal terminal.",
-        "exit",
-        "Examples:\n"
-        "  exit\n",
-        "Notes:\n"
-        "  Any running background processes are not managed by this shell.\n",
-        "help"
-    },
-    {
-        "bg",
-        "Run a command in the background",
-        "Runs an external command in the background (does not block the shell).",
-        "bg <command> [args...]",
-        "Examples:\n"
-        "  bg sleep 5\n"
-        "  bg python3 script.py\n",
-        "Notes:\n"
-        "  This runs external programs using execvp().\n"
-        "  Output and job control are minimal.\n",
-        "history, help"
-    },
-    {
-        "history",
-        "Show command history",
-        "Shows previously executed commands in this shell session.",
-        "history",
-        "Examples:\n"
-        "  history\n",
-        "Notes:\n"
-        "  History is kept only for the current session.\n",
-        "help"
-    },
-    {
-        "clear",
-        "Clear the screen",
-        "Clears the terminal screen using ANSI escape codes.",
-        "clear",
-        "Examples:\n"
-        "  clear\n",
-        "Tip:\n"
-        "  If your terminal scrollback is messy, clear can help.\n",
-        "help"
-    },
-    {
-        "echo",
-        "Print text",
-        "Prints the given text to the terminal.",
-        "echo <text...>",
-        "Examples:\n"
-        "  echo hello\n"
-        "  echo \"hello world\"\n",
-        "Notes:\n"
-        "  This is a simple echo; it does not support advanced flags.\n",
-        "pwd, ls"
-    },
-    {
-        "pwd",
-        "Print working directory",
-        "Prints the current working directory path.",
-        "pwd",
-        "Examples:\n"
-        "  pwd\n",
-        "Related:\n"
-        "  cd changes directories; pwd shows where you are.\n",
-        "cd, ls, tree"
-    },
-    {
-        "ls",
-        "List directory contents",
-        "Lists files and folders in a directory (non-hidden entries only).",
-        "ls\nls <path>",
-        "Examples:\n"
-        "  ls\n"
-        "  ls ..\n",
-        "Notes:\n"
-        "  This built-in ls is minimal (not the full GNU/BSD ls).\n",
-        "tree, count, find"
-    },
-    {
-        "version",
-        "Show shell version",
-        "Displays the version of this AI Automated Custom Shell.",
-        "version",
-        "Examples:\n"
-        "  version\n",
-        "Common version flags (general, not implemented here):\n"
-        "  --version  - Version info (many tools)\n"
-        "  -v         - Short version output\n"
-        "  -V         - Detailed version output\n"
-        "  about      - App info (some CLIs)\n",
-        "help, whoami, pwd"
-    },
-    {
-        "calc",
-        "Simple calculator",
-        "Evaluates a simple binary arithmetic expression.",
-        "calc <number> <operator> <number>\nOperators: +  -  *  /  %  ^",
-        "Examples:\n"
-        "  calc 10 + 5\n"
-        "  calc 2 ^ 8\n",
-        "Notes:\n"
-        "  Division by zero is checked.\n",
-        "echo, datetime"
-    },
-    {
-        "datetime",
-        "Show date and time",
-        "Prints the current date and time in a friendly format.",
-        "datetime",
-        "Examples:\n"
-        "  datetime\n",
-        "Related:\n"
-        "  Useful for timestamps and quick checks.\n",
-        "version, pwd"
-    },
-    {
-        "count",
-        "Count files and directories",
-        "Counts items in a directory and prints totals (directories vs files).",
-        "count\ncount <path>",
-        "Examples:\n"
-        "  count\n"
-        "  count ..\n",
-        "Notes:\n"
-        "  Counting is based on whether opendir() succeeds on an entry.\n",
-        "ls, tree, find"
-    },
-    {
-        "find",
-        "Find files by name pattern",
-        "Recursively searches for files matching a glob pattern (e.g., *.c).",
-        "find <pattern>",
-        "Examples:\n"
-        "  find \"*.c\"\n"
-        "  find \"*.txt\"\n",
-        "Notes:\n"
-        "  Pattern matching uses fnmatch().\n",
-        "ls, tree, count"
-    },
-    {
-        "cat",
-        "Print a file to the screen",
-        "Displays the contents of a file.",
-        "cat <filename>",
-        "Examples:\n"
-        "  cat README.md\n",
-        "Notes:\n"
-        "  This reads and prints the file as text.\n",
-        "ls, find"
-    },
-    {
-        "tree",
-        "Show directory tree",
-        "Displays a tree view of a directory (folders and files).",
-        "tree\ntree <path>",
-        "Examples:\n"
-        "  tree\n"
-        "  tree ..\n",
-        "Related:\n"
-        "  Use ls for a flat list; tree for structure.\n",
-        "ls, count, find"
-    },
-    {
-        "mkdir",
-        "Create a directory",
-        "Creates a new directory.",
-        "mkdir <directory_name>",
-        "Examples:\n"
-        "  mkdir test_folder\n",
-        "Notes:\n"
-        "  Permissions are set to 0755.\n",
-        "touch, rm, ls"
-    },
-    {
-        "touch",
-        "Create an empty file",
-        "Creates a file if it doesn't exist (or updates its timestamp).",
-        "touch <filename>",
-        "Examples:\n"
-        "  touch notes.txt\n",
-        "Notes:\n"
-        "  This uses fopen(..., \"a\") to create/update.\n",
-        "cat, ls, rm"
-    },
-    {
-        "rm",
-        "Remove a file",
-        "Removes (deletes) a file.",
-        "rm <filename>",
-        "Examples:\n"
-        "  rm notes.txt\n",
-        "Warning:\n"
-        "  This permanently deletes the file (no trash).\n",
-        "ls, touch, mkdir"
-    },
-    {
-        "whoami",
-        "Show current user",
-        "Prints the current username (from the USER environment variable).",
-        "whoami",
-        "Examples:\n"
-        "  whoami\n",
-        "Notes:\n"
-        "  If USER is not set, it prints 'Unknown user'.\n",
-        "pwd, version, help"
-    }
-};
 
 static int starts_with_icase(const char *s, const char *prefix) {
     if (!s || !prefix) return 0;
@@ -315,91 +75,51 @@ static int starts_with_icase(const char *s, const char *prefix) {
     return 1;
 }
 
-static const BuiltinHelp* find_help_exact_icase(const char *name) {
-    if (!name) return NULL;
-    for (size_t i = 0; i < sizeof(BUILTIN_HELP)/sizeof(BUILTIN_HELP[0]); i++) {
-        const char *n = BUILTIN_HELP[i].name;
-        if (n && strlen(n) == strlen(name) && starts_with_icase(n, name)) {
-            return &BUILTIN_HELP[i];
-        }
-    }
-    return NULL;
-}
-
-static void print_help_page(const BuiltinHelp *h) {
+static void print_help_page(const Builtin *h) {
     if (!h) return;
-    printf("Command: %s\n", h->name);
-    printf("Summary: %s\n\n", h->summary);
-    printf("What it does:\n%s\n\n", h->what);
-    printf("Basic usage:\n%s\n\n", h->usage);
+    term_printf("Command: %s\n", h->name);
+    term_printf("Summary: %s\n\n", h->summary);
+    term_printf("What it does:\n%s\n\n", h->what);
+    term_printf("Basic usage:\n%s\n\n", h->usage);
     if (h->examples && strlen(h->examples) > 0) {
-        printf("%s\n", h->examples);
+        term_printf("%s\n", h->examples);
     }
     if (h->common && strlen(h->common) > 0) {
-        printf("%s\n", h->common);
+        term_printf("%s\n", h->common);
     }
     if (h->related && strlen(h->related) > 0) {
-        printf("Related:\n  %s\n", h->related);
+        term_printf("Related:\n  %s\n", h->related);
     }
 }
 
 static void print_match_list(const char *partial) {
-    printf("Possible commands for '%s':\n", partial && *partial ? partial : "");
-    for (size_t i = 0; i < sizeof(BUILTIN_HELP)/sizeof(BUILTIN_HELP[0]); i++) {
-        if (!partial || !*partial || starts_with_icase(BUILTIN_HELP[i].name, partial)) {
-            printf("  %-8s - %s\n", BUILTIN_HELP[i].name, BUILTIN_HELP[i].summary);
-        }
+    term_printf("Possible commands for '%s':\n", partial && *partial ? partial : "");
+    if (!partial) partial = "";
+    for (size_t i = builtin_prefix_start(partial);
+         i < BUILTIN_COUNT && starts_with_icase(BUILTINS[i].name, partial); i++) {
+        term_printf("  %-8s - %s\n", BUILTINS[i].name, BUILTINS[i].summary);
     }
-    printf("\nTip: keep typing to narrow it down, then press TAB again for detailed help.\n");
+    term_puts("\nTip: keep typing to narrow it down, then press TAB again for detailed help.\n");
 }
 
-static int is_duplicate_name(const char *name, char names[][256], int count) {
-    for (int i = 0; i < count; i++) {
-        if (strcmp(names[i], name) == 0) return 1;
-    }
-    return 0;
-}
+// External completion candidates. Names are interned in an arena that is
+// reset (not freed) on every TAB, so there is no cap on the number of
+// matches and no per-name allocation.
+typedef struct {
+    const char *name;
+    size_t len;
+    int bad;            // contains a hyphen or digit (ranked lower)
+    Frecency use;       // how often/recently the user ran it
+} Candidate;
 
-static int collect_path_executables_with_prefix(const char *prefix, char names[][256], int max_names) {
-    if (!prefix || !*prefix) return 0;
-
-    const char *path_env = getenv("PATH");
-    if (!path_env || !*path_env) return 0;
-
-    char *path_copy = strdup(path_env);
-    if (!path_copy) return 0;
-
-    int count = 0;
-    char *saveptr = NULL;
-    char *dir_path = strtok_r(path_copy, ":", &saveptr);
-    while (dir_path && count < max_names) {
-        DIR *d = opendir(dir_path);
-        if (d) {
-            struct dirent *ent;
-            while ((ent = readdir(d)) != NULL && count < max_names) {
-                const char *name = ent->d_name;
-                if (!name || name[0] == '.') continue;
-                if (!starts_with_icase(name, prefix)) continue;
-
-                // Build full path and check executable bit
-                char full[1024];
-                snprintf(full, sizeof(full), "%s/%s", dir_path, name);
-                if (access(full, X_OK) != 0) continue;
-
-                // Avoid duplicates across PATH dirs
-                if (is_duplicate_name(name, names, count)) continue;
-
-                snprintf(names[count], 256, "%s", name);
-                count++;
-            }
-            closedir(d);
-        }
-        dir_path = strtok_r(NULL, ":", &saveptr);
-    }
+typedef struct {
+    Arena arena;
+    Candidate *items;
+    int count;
+    int cap;
+} CandidateList;
 
-    free(path_copy);
-    return count;
-}
+static CandidateList g_candidates = { { NULL, NULL, ARENA_DEFAULT_BLOCK }, NULL, 0, 0 };
 
 static int has_hyphen_or_digit(const char *s) {
     for (const char *p = s; p && *p; p++) {
@@ -408,34 +128,90 @@ static int has_hyphen_or_digit(const char *s) {
     return 0;
 }
 
+static void collect_candidate(const char *name, const char *dir, void *user) {
+    CandidateList *c = (CandidateList *)user;
+    if (c->count >= c->cap) {
+        // Grow inside the arena; the old array is reclaimed on the next reset
+        int cap = c->cap ? c->cap * 2 : 64;
+        Candidate *items = arena_alloc(&c->arena, cap * sizeof(Candidate));
+        if (!items) return;
+        if (c->count) memcpy(items, c->items, c->count * sizeof(Candidate));
+        c->items = items;
+        c->cap = cap;
+    }
+
+    size_t len = strlen(name);
+    const char *interned = arena_strndup(&c->arena, name, len);
+    if (!interned) return;
+    c->items[c->count].name = interned;
+    c->items[c->count].len = len;
+    c->items[c->count].bad = has_hyphen_or_digit(name);
+    frecency_lookup(name, &c->items[c->count].use);
+    c->count++;
+}
+
+// Collect every PATH executable starting with prefix from the PATH index
+// (one binary-search range query; directories are rescanned only when they change).
+static CandidateList *collect_path_executables_with_prefix(const char *prefix) {
+    CandidateList *c = &g_candidates;
+    arena_reset(&c->arena);
+    c->items = NULL;
+    c->count = 0;
+    c->cap = 0;
+    if (!prefix || !*prefix) return c;
+
+    path_index_for_prefix(prefix, collect_candidate, c);
+    return c;
+}
+
+// Ranking used for both the best pick and the displayed list: commands the
+// user runs most (and most recently) first, then no hyphen or digit, then
+// shorter names, then by name so the result never depends on directory order.
+static int compare_candidates(const Candidate *a, const Candidate *b) {
+    int used = frecency_compare(&a->use, &b->use);
+    if (used != 0) return used;
+    if (a->bad != b->bad) return a->bad - b->bad;
+    if (a->len != b->len) return a->len < b->len ? -1 : 1;
+    return strcmp(a->name, b->name);
+}
+
 // Pick a "best" candidate deterministically for common cases like:
-// gc -> gcc (prefer short, no hyphen/digits).
+// gc -> gcc (prefer what the user runs, then short, no hyphen/digits).
 // Returns index of best candidate, or -1 if ambiguous/tied.
-static int pick_best_external_candidate(char names[][256], int n) {
-    if (n <= 0) return -1;
+static int pick_best_external_candidate(const CandidateList *c) {
+    if (c->count <= 0) return -1;
 
     int best = 0;
-    int best_bad = has_hyphen_or_digit(names[0]);
-    size_t best_len = strlen(names[0]);
-    int tie = 0;
-
-    for (int i = 1; i < n; i++) {
-        int bad = has_hyphen_or_digit(names[i]);
-        size_t len = strlen(names[i]);
-
-        if (bad < best_bad) {
-            best = i; best_bad = bad; best_len = len; tie = 0;
-        } else if (bad == best_bad) {
-            if (len < best_len) {
-                best = i; best_len = len; tie = 0;
-            } else if (len == best_len) {
-                // Same "quality" and same length -> ambiguous
-                tie = 1;
-            }
+    for (int i = 1; i < c->count; i++) {
+        if (compare_candidates(&c->items[i], &c->items[best]) < 0) best = i;
+    }
+
+    // Same usage, same "quality" and same length as the best -> ambiguous
+    for (int i = 0; i < c->count; i++) {
+        if (i != best && frecency_compare(&c->items[i].use, &c->items[best].use) == 0 &&
+            c->items[i].bad == c->items[best].bad && c->items[i].len == c->items[best].len) {
+            return -1;
         }
     }
+    return best;
+}
 
-    return tie ? -1 : best;
+// Fill top[] with the k best candidates in rank order (one pass over all
+// matches). Returns how many were written.
+static int rank_top_candidates(const CandidateList *c, const Candidate **top, int k) {
+    int n = 0;
+    for (int i = 0; i < c->count; i++) {
+        const Candidate *cand = &c->items[i];
+        if (n == k && compare_candidates(cand, top[n - 1]) >= 0) continue;
+
+        int pos = (n < k) ? n++ : k - 1;
+        while (pos > 0 && compare_candidates(cand, top[pos - 1]) < 0) {
+            top[pos] = top[pos - 1];
+            pos--;
+        }
+        top[pos] = cand;
+    }
+    return n;
 }
 
 // Returns:
@@ -452,16 +228,15 @@ int complete_external_command(const char* partial_cmd, char* out, size_t out_sz)
         if (*p == ' ' || *p == '\t') return 0;
     }
 
-    char names[32][256];
-    int n = collect_path_executables_with_prefix(partial_cmd, names, 32);
-    if (n == 1) {
-        snprintf(out, out_sz, "%s", names[0]);
+    CandidateList *c = collect_path_executables_with_prefix(partial_cmd);
+    if (c->count == 1) {
+        snprintf(out, out_sz, "%s", c->items[0].name);
         return 1;
     }
-    if (n > 1) {
-        int best = pick_best_external_candidate(names, n);
+    if (c->count > 1) {
+        int best = pick_best_external_candidate(c);
         if (best >= 0) {
-            snprintf(out, out_sz, "%s", names[best]);
+            snprintf(out, out_sz, "%s", c->items[best].name);
             return 1;
         }
         return 2;
@@ -469,6 +244,254 @@ int complete_external_command(const char* partial_cmd, char* out, size_t out_sz)
     return 0;
 }
 
+// ---------------------------------------------------------------------------
+// Fuzzy completion over the builtin table, the PATH index and history.
+// Candidates are rejected with a character-mask test first; survivors are
+// scored with fuzzy_match() and kept in a small top-K array.
+// ---------------------------------------------------------------------------
+
+#define FUZZY_TOP_K 10
+
+typedef struct {
+    const char *text;    // interned in the candidate arena
+    const char *source;  // "history", "builtin" or "command"
+    int score;
+} FuzzyHit;
+
+typedef struct {
+    const char *pattern;
+    uint64_t need;
+    const char *source;
+    FuzzyHit top[FUZZY_TOP_K];
+    int count;
+    int total;           // all matches, not just the ones kept
+} FuzzySearch;
+
+static int compare_fuzzy_hits(const FuzzyHit *a, const FuzzyHit *b) {
+    if (a->score != b->score) return a->score > b->score ? -1 : 1;
+    size_t la = strlen(a->text), lb = strlen(b->text);
+    if (la != lb) return la < lb ? -1 : 1;
+    return strcmp(a->text, b->text);
+}
+
+static void fuzzy_consider(FuzzySearch *fs, const char *text) {
+    if ((fuzzy_charmask(text) & fs->need) != fs->need) return;
+    int score;
+    if (!fuzzy_match(fs->pattern, text, &score)) return;
+    fs->total++;
+
+    // The same text can come from several sources; keep its first (best) one
+    for (int i = 0; i < fs->count; i++) {
+        if (strcmp(fs->top[i].text, text) == 0) {
+            if (score > fs->top[i].score) fs->top[i].score = score;
+            return;
+        }
+    }
+
+    FuzzyHit hit = { text, fs->source, score };
+    if (fs->count == FUZZY_TOP_K && compare_fuzzy_hits(&hit, &fs->top[FUZZY_TOP_K - 1]) >= 0) return;
+    hit.text = arena_strdup(&g_candidates.arena, text);
+    if (!hit.text) return;
+
+    int pos = (fs->count < FUZZY_TOP_K) ? fs->count++ : FUZZY_TOP_K - 1;
+    while (pos > 0 && compare_fuzzy_hits(&hit, &fs->top[pos - 1]) < 0) {
+        fs->top[pos] = fs->top[pos - 1];
+        pos--;
+    }
+    fs->top[pos] = hit;
+}
+
+static void fuzzy_visit_command(const char *name, const char *dir, void *user) {
+    fuzzy_consider((FuzzySearch *)user, name);
+}
+
+static void fuzzy_visit_history(const char *line, void *user) {
+    // Only lines that fit the matcher are considered
+    if (strlen(line) > FUZZY_MAX_TEXT) return;
+    fuzzy_consider((FuzzySearch *)user, line);
+}
+
+static void fuzzy_search(const char *pattern, FuzzySearch *fs) {
+    memset(fs, 0, sizeof(*fs));
+    fs->pattern = pattern;
+    fs->need = fuzzy_charmask(pattern);
+    arena_reset(&g_candidates.arena);
+
+    // History first so an identical builtin/command keeps the history tag
+    fs->source = "history";
+    ripple_history_foreach(fuzzy_visit_history, fs);
+
+    fs->source = "builtin";
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        fuzzy_consider(fs, BUILTINS[i].name);
+    }
+
+    fs->source = "command";
+    path_index_for_mask(fs->need, fuzzy_visit_command, fs);
+}
+
+// Returns:
+//  0 = nothing matches fuzzily
+//  1 = a best match exists (written to out)
+//  2 = the top matches tie (no completion written)
+// Only an exact tie (same score and length) makes the best match ambiguous
+static int fuzzy_best_is_tied(const FuzzySearch *fs) {
+    return fs->count > 1 && fs->top[0].score == fs->top[1].score &&
+           strlen(fs->top[0].text) == strlen(fs->top[1].text);
+}
+
+int complete_fuzzy_command(const char* partial_cmd, char* out, size_t out_sz) {
+    if (!out || out_sz == 0) return 0;
+    out[0] = '\0';
+    if (!partial_cmd || !*partial_cmd) return 0;
+
+    FuzzySearch fs;
+    fuzzy_search(partial_cmd, &fs);
+    if (fs.count == 0) return 0;
+    if (fuzzy_best_is_tied(&fs)) return 2;
+    snprintf(out, out_sz, "%s", fs.top[0].text);
+    return 1;
+}
+
+// ---------------------------------------------------------------------------
+// Inline autosuggestion ("ghost text"). The candidate set for the current
+// prefix is kept between keystrokes: when the user types one more character
+// the previous history hits and command names are filtered instead of
+// searched again, and a history scan that ran out of time resumes where it
+// stopped on the next keystroke.
+// ---------------------------------------------------------------------------
+
+#define AUTOSUGGEST_BUDGET_NS 2000000L     // per keystroke
+#define AUTOSUGGEST_MAX_HITS 256           // history matches kept for refining
+
+static struct {
+    char *prefix;
+    size_t len;
+    size_t cap;
+    size_t hist_count;       // history size when the search started
+    size_t hist_next;        // entries [hist_next, hist_count) are scanned
+    size_t hits[AUTOSUGGEST_MAX_HITS];   // matching history indices, newest first
+    int nhits;
+    CandidateList cmds;      // builtins and PATH names (first word only)
+} g_suggest = { .cmds = { { NULL, NULL, ARENA_DEFAULT_BLOCK }, NULL, 0, 0 } };
+
+static long elapsed_ns(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000L + (now.tv_nsec - start->tv_nsec);
+}
+
+// The PATH index matches case-insensitively, but a suggestion has to
+// extend exactly what was typed
+typedef struct {
+    CandidateList *list;
+    const char *prefix;
+    size_t len;
+} PrefixFilter;
+
+static void collect_exact_prefix(const char *name, const char *dir, void *user) {
+    PrefixFilter *f = (PrefixFilter *)user;
+    if (strncmp(name, f->prefix, f->len) == 0) collect_candidate(name, dir, f->list);
+}
+
+static void autosuggest_restart(const char *line, size_t len) {
+    g_suggest.hist_count = history_count();
+    g_suggest.hist_next = g_suggest.hist_count;
+    g_suggest.nhits = 0;
+
+    CandidateList *c = &g_suggest.cmds;
+    arena_reset(&c->arena);
+    c->items = NULL;
+    c->count = 0;
+    c->cap = 0;
+    if (memchr(line, ' ', len)) return;
+
+    for (size_t i = builtin_prefix_start(line);
+         i < BUILTIN_COUNT && starts_with_icase(BUILTINS[i].name, line); i++) {
+        if (strncmp(BUILTINS[i].name, line, len) == 0) {
+            collect_candidate(BUILTINS[i].name, NULL, c);
+        }
+    }
+    // Only what the indexer already has: a PATH scan here would stall typing
+    PrefixFilter filter = { c, line, len };
+    path_index_for_prefix_indexed(line, collect_exact_prefix, &filter);
+}
+
+// Drop the kept candidates that no longer start with the (longer) prefix
+static void autosuggest_refine(const char *line, size_t len) {
+    int n = 0;
+    for (int i = 0; i < g_suggest.nhits; i++) {
+        const char *h = history_get(g_suggest.hits[i]);
+        if (strncmp(h, line, len) == 0 && h[len] != '\0') {
+            g_suggest.hits[n++] = g_suggest.hits[i];
+        }
+    }
+    g_suggest.nhits = n;
+
+    CandidateList *c = &g_suggest.cmds;
+    if (memchr(line, ' ', len)) {
+        c->count = 0;
+        return;
+    }
+    n = 0;
+    for (int i = 0; i < c->count; i++) {
+        if (strncmp(c->items[i].name, line, len) == 0) c->items[n++] = c->items[i];
+    }
+    c->count = n;
+}
+
+// Best full-line suggestion for line, or NULL. Prefers the newest history
+// entry that extends it, then the best-ranked command name. The returned
+// pointer is valid until the next call or history change.
+const char* autosuggest_line(const char* line) {
+    size_t len = line ? strlen(line) : 0;
+    if (len == 0) return NULL;
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int extends = g_suggest.prefix && len > g_suggest.len &&
+                  memcmp(line, g_suggest.prefix, g_suggest.len) == 0 &&
+                  g_suggest.hist_count == history_count();
+    if (len + 1 > g_suggest.cap) {
+        char *p = realloc(g_suggest.prefix, len + 64);
+        if (!p) return NULL;
+        g_suggest.prefix = p;
+        g_suggest.cap = len + 64;
+    }
+    if (extends) {
+        autosuggest_refine(line, len);
+    } else if (!(g_suggest.prefix && len == g_suggest.len && memcmp(line, g_suggest.prefix, len) == 0)) {
+        autosuggest_restart(line, len);
+    }
+    memcpy(g_suggest.prefix, line, len + 1);
+    g_suggest.len = len;
+
+    // Continue the history scan (newest first) until a hit, the hit list is
+    // full, or the time budget is spent. Only lines that extend the prefix
+    // count: one equal to it has nothing to suggest, and repeats of what was
+    // typed must not fill the list and stop the scan.
+    while (g_suggest.hist_next > 0 && g_suggest.nhits < AUTOSUGGEST_MAX_HITS) {
+        size_t i = --g_suggest.hist_next;
+        const char *h = history_get(i);
+        if (strncmp(h, line, len) == 0 && h[len] != '\0') {
+            g_suggest.hits[g_suggest.nhits++] = i;
+            break;
+        }
+        if ((i & 63) == 0 && elapsed_ns(&start) > AUTOSUGGEST_BUDGET_NS) break;
+    }
+
+    if (g_suggest.nhits > 0) return history_get(g_suggest.hits[0]);
+
+    const Candidate *best = NULL;
+    for (int i = 0; i < g_suggest.cmds.count; i++) {
+        const Candidate *cand = &g_suggest.cmds.items[i];
+        if (cand->len == len) continue;
+        if (!best || compare_candidates(cand, best) < 0) best = cand;
+    }
+    return best ? best->name : NULL;
+}
+
 // Returns:
 //  0 = no built-in match
 //  1 = unique completion found (written to out)
@@ -478,22 +501,33 @@ int complete_builtin_command(const char* partial_cmd, char* out, size_t out_sz)
     out[0] = '\0';
     if (!partial_cmd || !*partial_cmd) return 0;
 
-    const BuiltinHelp *exact = find_help_exact_icase(partial_cmd);
+    const Builtin *exact = builtin_find_icase(partial_cmd);
     if (exact) {
         snprintf(out, out_sz, "%s", exact->name);
         return 1;
     }
 
+    // Several matches: take the one the user runs most, unless that ties
     int match_count = 0;
-    const BuiltinHelp *single = NULL;
-    for (size_t i = 0; i < sizeof(BUILTIN_HELP)/sizeof(BUILTIN_HELP[0]); i++) {
-        if (starts_with_icase(BUILTIN_HELP[i].name, partial_cmd)) {
-            match_count++;
-            single = &BUILTIN_HELP[i];
+    int tied = 0;
+    const Builtin *single = NULL;
+    Frecency single_use = { 0, 0 };
+    for (size_t i = builtin_prefix_start(partial_cmd);
+         i < BUILTIN_COUNT && starts_with_icase(BUILTINS[i].name, partial_cmd); i++) {
+        Frecency use;
+        frecency_lookup(BUILTINS[i].name, &use);
+        int cmp = single ? frecency_compare(&use, &single_use) : -1;
+        if (cmp < 0) {
+            single = &BUILTINS[i];
+            single_use = use;
+            tied = 0;
+        } else if (cmp == 0) {
+            tied = 1;
         }
+        match_count++;
     }
 
-    if (match_count == 1 && single) {
+    if (single && (match_count == 1 || !tied)) {
         snprintf(out, out_sz, "%s", single->name);
         return 1;
     }
@@ -546,31 +580,31 @@ void suggest_external_args(const char* cmd, const char* partial_arg) {
     if (!partial_arg) partial_arg = "";
 
     if (strcmp(cmd, "gcc") != 0) {
-        printf("No argument suggestions for '%s' yet.\n", cmd);
-        printf("Tip: try '%s --help'\n", cmd);
+        term_printf("No argument suggestions for '%s' yet.\n", cmd);
+        term_printf("Tip: try '%s --help'\n", cmd);
         return;
     }
 
-    printf("gcc format:\n");
-    printf("  gcc <source.c> -o <output>\n");
-    printf("Examples:\n");
-    printf("  gcc hello.c -o hello\n");
-    printf("  gcc -Wall -Wextra -Werror -g hello.c -o hello\n\n");
+    term_puts("gcc format:\n"
+              "  gcc <source.c> -o <output>\n"
+              "Examples:\n"
+              "  gcc hello.c -o hello\n"
+              "  gcc -Wall -Wextra -Werror -g hello.c -o hello\n\n");
 
     const FlagHelp *matches[32];
     int n = collect_flag_matches(GCC_FLAGS, (int)(sizeof(GCC_FLAGS)/sizeof(GCC_FLAGS[0])), partial_arg, matches, 32);
 
     if (partial_arg && *partial_arg) {
-        printf("gcc flags matching '%s':\n", partial_arg);
+        term_printf("gcc flags matching '%s':\n", partial_arg);
     } else {
-        printf("Common gcc flags:\n");
+        term_puts("Common gcc flags:\n");
     }
 
     for (int i = 0; i < n && i < 12; i++) {
-        printf("  %-18s - %s\n", matches[i]->flag, matches[i]->desc);
+        term_printf("  %-18s - %s\n", matches[i]->flag, matches[i]->desc);
     }
     if (n > 12) {
-        printf("  ... (%d more)\n", n - 12);
+        term_printf("  ... (%d more)\n", n - 12);
     }
 }
 
@@ -619,182 +653,382 @@ static char* escape_json_string(const char* input) {
     return escaped;
 }
 
-// Function to handle memory allocation for curl response
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
+// Append raw bytes to a growable, NUL-terminated buffer.
+static int memory_append(struct MemoryStruct *mem, const char *data, size_t len) {
+    char *ptr = realloc(mem->memory, mem->size + len + 1);
     if(!ptr) {
         printf("Not enough memory (realloc returned NULL)\n");
         return 0;
     }
-    
+
     mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
+    memcpy(&(mem->memory[mem->size]), data, len);
+    mem->size += len;
     mem->memory[mem->size] = 0;
-    
+    return 1;
+}
+
+// State for one streamed ("stream": true) generate request.
+// Ollama sends one JSON object per line (NDJSON); each carries a few tokens
+// in "response". We keep the unfinished line between curl callbacks, collect
+// the full text, hand every token to the caller as it arrives and stop the
+// transfer as soon as max_lines non-empty output lines are complete.
+typedef struct {
+    struct MemoryStruct pending; // partial NDJSON line
+    struct MemoryStruct text;    // response text received so far
+    int max_lines;
+    int lines_done;
+    int line_has_text;
+    int stopped;                 // we aborted early on purpose
+    ollama_token_cb on_token;
+    void *user;
+} OllamaStream;
+
+// Feed one token of model output; returns 1 once enough lines are complete.
+static int stream_take_token(OllamaStream *st, const char *tok, size_t len) {
+    size_t keep = len;
+    for (size_t i = 0; i < len; i++) {
+        if (tok[i] == '\n') {
+            if (st->line_has_text) st->lines_done++;
+            st->line_has_text = 0;
+            if (st->max_lines > 0 && st->lines_done >= st->max_lines) {
+                keep = i + 1;
+                break;
+            }
+        } else if (!isspace((unsigned char)tok[i])) {
+            st->line_has_text = 1;
+        }
+    }
+
+    memory_append(&st->text, tok, keep);
+    if (st->on_token && keep > 0) st->on_token(tok, keep, st->user);
+    return st->max_lines > 0 && st->lines_done >= st->max_lines;
+}
+
+// Parse one complete NDJSON line; returns 1 when the stream should end.
+static int stream_take_line(OllamaStream *st, const char *line) {
+    struct json_object *obj = json_tokener_parse(line);
+    if (!obj) return 0;
+
+    int finished = 0;
+    struct json_object *field;
+    if (json_object_object_get_ex(obj, "response", &field)) {
+        const char *tok = json_object_get_string(field);
+        if (tok && *tok) finished = stream_take_token(st, tok, strlen(tok));
+    }
+    if (json_object_object_get_ex(obj, "done", &field) && json_object_get_boolean(field)) {
+        finished = 1;
+    }
+    json_object_put(obj);
+    return finished;
+}
+
+static size_t StreamWriteCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    OllamaStream *st = (OllamaStream *)userp;
+    const char *data = (const char *)contents;
+
+    size_t start = 0;
+    for (size_t i = 0; i < realsize; i++) {
+        if (data[i] != '\n') continue;
+        if (!memory_append(&st->pending, data + start, i - start)) return 0;
+        start = i + 1;
+
+        int finished = stream_take_line(st, st->pending.memory);
+        st->pending.size = 0;
+        st->pending.memory[0] = '\0';
+        if (finished) {
+            // Returning a short count makes curl abort the transfer, which
+            // also tells Ollama to stop generating tokens we will not show.
+            st->stopped = 1;
+            return 0;
+        }
+    }
+    if (start < realsize && !memory_append(&st->pending, data + start, realsize - start)) return 0;
     return realsize;
 }
 
-// Function to get AI-based command completion using Ollama API
-char* get_ollama_completion(const char* prompt) {
+// Long-lived Ollama HTTP client.
+// One easy handle is created at shell startup and reused for every request so
+// libcurl can keep the connection to the Ollama server alive between TAB presses.
+typedef struct {
     CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-    
-    if (!chunk.memory) {
+    struct curl_slist *headers;
+    const char *last_error;   // curl_easy_strerror() text of the last failure
+    int ready;
+    char commands[1024];      // "cat, cd, ...": the builtins, for the completion prompt
+} OllamaClient;
+
+static OllamaClient g_ollama = { NULL, NULL, NULL, 0, "" };
+
+// Background worker for AI lookups (see ai_async_* below). Declared here so
+// the curl progress callback can tell when the running job went stale.
+typedef enum {
+    AI_JOB_COMPLETION,
+    AI_JOB_DESCRIPTION
+} AiJobKind;
+
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    int started;
+    int stopping;
+    int notify_fd[2];          // worker -> line editor "output ready" pipe
+
+    unsigned long gen;         // bumped on every submit and cancel
+    unsigned long running_gen; // generation of the job being executed
+
+    int has_job;               // queued job (only the newest one is kept)
+    AiJobKind kind;
+    char text[256];
+
+    struct MemoryStruct out;   // streamed text of the current job
+    size_t out_taken;          // bytes already handed to the line editor
+    int out_done;
+    int out_failed;
+    char out_error[128];       // why it failed, copied from the worker's client
+    int out_labelled;
+    int out_line_start;
+} AiWorker;
+
+static AiWorker g_ai = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .wake = PTHREAD_COND_INITIALIZER,
+    .notify_fd = { -1, -1 },
+};
+
+// Abort the transfer when the job it belongs to was cancelled or replaced.
+static int OllamaProgressCallback(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                  curl_off_t ultotal, curl_off_t ulnow) {
+    // started and thread are written under the lock, so a transfer in the
+    // worker's first moments (or on the shell's own thread) reads them safely
+    pthread_mutex_lock(&g_ai.lock);
+    int stale = g_ai.started && pthread_equal(pthread_self(), g_ai.thread) &&
+                (g_ai.stopping || g_ai.gen != g_ai.running_gen);
+    pthread_mutex_unlock(&g_ai.lock);
+    return stale;
+}
+
+int ollama_client_init(void) {
+    if (g_ollama.ready) return 1;
+
+    // Named in every completion prompt; taken from the table so it cannot
+    // fall behind the builtins the shell really has
+    size_t used = 0;
+    g_ollama.commands[0] = '\0';
+    for (size_t i = 0; i < BUILTIN_COUNT; i++) {
+        int n = snprintf(g_ollama.commands + used, sizeof(g_ollama.commands) - used,
+                         "%s%s", i ? ", " : "", BUILTINS[i].name);
+        if (n < 0 || (size_t)n >= sizeof(g_ollama.commands) - used) break;
+        used += (size_t)n;
+    }
+    g_ollama.commands[used] = '\0';
+
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) return 0;
+    g_ollama.curl = curl_easy_init();
+    if (!g_ollama.curl) {
+        curl_global_cleanup();
+        return 0;
+    }
+    g_ollama.headers = curl_slist_append(NULL, "Content-Type: application/json");
+
+    // Options that never change between requests are set once here.
+    curl_easy_setopt(g_ollama.curl, CURLOPT_URL, OLLAMA_API_URL);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_HTTPHEADER, g_ollama.headers);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_WRITEFUNCTION, StreamWriteCallback);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_XFERINFOFUNCTION, OllamaProgressCallback);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_NOPROGRESS, 0L);
+
+    // Never hang forever: fail fast when Ollama is down, and give up on a
+    // reply that stops producing tokens.
+    curl_easy_setopt(g_ollama.curl, CURLOPT_CONNECTTIMEOUT_MS, 2000L);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_LOW_SPEED_TIME, 30L);
+    g_ollama.ready = 1;
+    return 1;
+}
+
+void ollama_client_cleanup(void) {
+    if (!g_ollama.ready) return;
+    curl_slist_free_all(g_ollama.headers);
+    curl_easy_cleanup(g_ollama.curl);
+    curl_global_cleanup();
+    g_ollama.curl = NULL;
+    g_ollama.headers = NULL;
+    g_ollama.ready = 0;
+}
+
+// Send one prompt to Ollama and return the "response" text (caller frees).
+// Shared by every AI lookup. The reply is streamed: on_token (may be NULL)
+// sees each piece of text as it arrives, and reading stops after max_lines
+// non-empty lines (0 = no limit). Returns NULL on network failure or when
+// nothing was received.
+static char* ollama_generate(const char* full_prompt, int num_predict, int max_lines,
+                             ollama_token_cb on_token, void *user) {
+    if (!full_prompt) return NULL;
+    if (!ollama_client_init()) return NULL;
+
+    // Escape the prompt for JSON
+    char *escaped_prompt = escape_json_string(full_prompt);
+    if (!escaped_prompt) {
+        g_ollama.last_error = "failed to escape prompt";
         return NULL;
     }
-    chunk.memory[0] = '\0';
-    
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-    
-    if(curl) {
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, "Content-Type: application/json");
-        
-        // Using tinyllama for quick responses
-        char json_data[4096]; // Increased buffer size for larger prompts
-        const char* prompt_template;
-        
-        // Special handling for cd command
-        if (strncmp(prompt, "cd", 2) == 0) {
-            prompt_template = "User typed: '%s'\n\n"
-                            "Complete Command: cd [directory]\n"
-                            "What it does: Changes the current working directory\n\n"
-                            "Suggested completions:\n"
-                            "1. cd ~ (Go to home directory)\n"
-                            "2. cd .. (Go up one directory)\n"
-                            "3. cd /path/to/directory (Go to specific path)";
-        } else {
-            // Simplified, direct prompt
-            prompt_template = "Complete the command '%s'. Available commands: version, calc, datetime, ls, pwd, whoami, help, tree, find, cat, count, mkdir, touch, rm, clear, echo, cd, exit, history, bg.\n\n"
-                            "Reply in this exact format (3 lines only):\n"
-                            "Complete: [full command]\n"
-                            "Does: [one short sentence]\n"
-                            "Similar: [command1], [command2], [command3]";
-        }
-        
-        // Create the full prompt
-        char full_prompt[2048];
-        snprintf(full_prompt, sizeof(full_prompt), prompt_template, prompt);
-        
-        // Escape the prompt for JSON
-        char* escaped_prompt = escape_json_string(full_prompt);
-        if (!escaped_prompt) {
-            fprintf(stderr, "Failed to escape prompt\n");
-            free(chunk.memory);
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return NULL;
-        }
-        
-        // Create the JSON request with stricter parameters for concise output
-        snprintf(json_data, sizeof(json_data), 
-                "{\"model\": \"tinyllama\", \"prompt\": \"%s\", \"stream\": false, \"temperature\": 0.1, \"top_p\": 0.5, \"top_k\": 20, \"num_predict\": 100}", 
-                escaped_prompt);
-        
+
+    // Create the JSON request with stricter parameters for concise output
+    const char *json_fmt =
+        "{\"model\": \"" OLLAMA_MODEL "\", \"prompt\": \"%s\", \"stream\": true, "
+        "\"temperature\": 0.1, \"top_p\": 0.5, \"top_k\": 20, \"num_predict\": %d}";
+    size_t json_sz = strlen(json_fmt) + strlen(escaped_prompt) + 32;
+    char *json_data = malloc(json_sz);
+    if (!json_data) {
         free(escaped_prompt);
-        
-        curl_easy_setopt(curl, CURLOPT_URL, OLLAMA_API_URL);
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_data);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-        
-        res = curl_easy_perform(curl);
-        
-        if(res != CURLE_OK) {
-            fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-            free(chunk.memory);
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return NULL;
-        }
-        
-        // Parse the response
-        struct json_object *parsed_json = json_tokener_parse(chunk.memory);
-        if (!parsed_json) {
-            fprintf(stderr, "Failed to parse JSON response\n");
-            free(chunk.memory);
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return NULL;
-        }
-        
-        struct json_object *response_obj;
-        if (json_object_object_get_ex(parsed_json, "response", &response_obj)) {
-            const char* response_text = json_object_get_string(response_obj);
-            char* result = strdup(response_text);
-            
-            json_object_put(parsed_json);
-            curl_slist_free_all(headers);
-            curl_easy_cleanup(curl);
-            free(chunk.memory);
-            curl_global_cleanup();
-            return result;
-        }
-        
-        json_object_put(parsed_json);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        free(chunk.memory);
-        curl_global_cleanup();
         return NULL;
     }
-    
-    free(chunk.memory);
-    curl_global_cleanup();
+    snprintf(json_data, json_sz, json_fmt, escaped_prompt, num_predict);
+    free(escaped_prompt);
+
+    OllamaStream st;
+    memset(&st, 0, sizeof(st));
+    st.max_lines = max_lines;
+    st.on_token = on_token;
+    st.user = user;
+    st.pending.memory = malloc(1);
+    st.text.memory = malloc(1);
+    if (!st.pending.memory || !st.text.memory) {
+        free(st.pending.memory);
+        free(st.text.memory);
+        free(json_data);
+        return NULL;
+    }
+    st.pending.memory[0] = '\0';
+    st.text.memory[0] = '\0';
+
+    curl_easy_setopt(g_ollama.curl, CURLOPT_POSTFIELDS, json_data);
+    curl_easy_setopt(g_ollama.curl, CURLOPT_WRITEDATA, (void *)&st);
+
+    CURLcode res = curl_easy_perform(g_ollama.curl);
+    free(json_data);
+
+    // A final line without a trailing newline still carries tokens.
+    if (res == CURLE_OK && st.pending.size > 0) {
+        stream_take_line(&st, st.pending.memory);
+    }
+    free(st.pending.memory);
+
+    if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && st.stopped)) {
+        g_ollama.last_error = curl_easy_strerror(res);
+        free(st.text.memory);
+        return NULL;
+    }
+    if (st.text.size == 0) {
+        g_ollama.last_error = "empty response";
+        free(st.text.memory);
+        return NULL;
+    }
+    return st.text.memory;
+}
+
+// Function to get AI-based command completion using Ollama API.
+// The streaming variant passes each token to on_token as soon as it arrives.
+char* get_ollama_completion(const char* prompt) {
+    return get_ollama_completion_stream(prompt, NULL, NULL);
+}
+
+char* get_ollama_completion_stream(const char* prompt, ollama_token_cb on_token, void *user) {
+    if (!prompt) return NULL;
+
+    // The cache answers every spelling of the prompt that normalizes the
+    // same, so the model is asked about that form, and the template follows
+    // its first word
+    char typed[1024];
+    completion_normalize(prompt, typed, sizeof(typed));
+    char full_prompt[4096];
+
+    // Special handling for cd command
+    if (strcmp(typed, "cd") == 0 || strncmp(typed, "cd ", 3) == 0) {
+        snprintf(full_prompt, sizeof(full_prompt),
+                 "User typed: '%s'\n\n"
+                 "Complete Command: cd [directory]\n"
+                 "What it does: Changes the current working directory\n\n"
+                 "Suggested completions:\n"
+                 "1. cd ~ (Go to home directory)\n"
+                 "2. cd .. (Go up one directory)\n"
+                 "3. cd /path/to/directory (Go to specific path)", typed);
+    } else {
+        // Simplified, direct prompt
+        snprintf(full_prompt, sizeof(full_prompt),
+                 "Complete the command '%s'. Available commands: %s.\n\n"
+                 "Reply in this exact format (3 lines only):\n"
+                 "Complete: [full command]\n"
+                 "Does: [one short sentence]\n"
+                 "Similar: [command1], [command2], [command3]", typed, g_ollama.commands);
+    }
+
+    // Identical partials are answered from the in-memory LRU. The key also
+    // covers everything that shapes the answer besides the prompt.
+    const char *params = OLLAMA_MODEL " num_predict=100 lines=3";
+    char *cached = completion_cache_lookup(prompt, params);
+    if (cached) {
+        if (on_token) on_token(cached, strlen(cached), user);
+        return cached;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    // Expected reply: Complete:/Does:/Similar:
+    char *result = ollama_generate(full_prompt, 100, 3, on_token, user);
+    if (result) {
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        unsigned long cost_ms = (unsigned long)((t1.tv_sec - t0.tv_sec) * 1000 +
+                                                (t1.tv_nsec - t0.tv_nsec) / 1000000);
+        completion_cache_store(prompt, params, result, cost_ms);
+    }
+    return result;
+}
+
+// Deterministic descriptions for common commands (prevents hallucinations).
+// Returns NULL when the model has to be asked.
+static const char* fixed_command_description(const char* cmd) {
+    if (strcmp(cmd, "gcc") == 0 || starts_with(cmd, "gcc-") || starts_with(cmd, "gcc")) {
+        return "Does: Compiles C/C++ source files into executables or object files.\n"
+               "Example: gcc hello.c -o hello\n"
+               "Example: gcc -Wall -Wextra -g hello.c -o hello\n";
+    }
     return NULL;
 }
 
 // Ask Ollama to describe an external command (short, practical).
-static char* get_ollama_command_description(const char* cmd) {
+// Tokens are streamed to on_token; the deterministic answers are returned
+// without calling it.
+static char* get_ollama_command_description(const char* cmd, ollama_token_cb on_token, void *user) {
     if (!cmd || !*cmd) return NULL;
 
-    // Deterministic descriptions for common commands (prevents hallucinations)
-    if (strcmp(cmd, "gcc") == 0 || starts_with(cmd, "gcc-") || starts_with(cmd, "gcc")) {
-        const char *fixed =
-            "Does: Compiles C/C++ source files into executables or object files.\n"
-            "Example: gcc hello.c -o hello\n"
-            "Example: gcc -Wall -Wextra -g hello.c -o hello\n";
-        return strdup(fixed);
-    }
+    const char *fixed = fixed_command_description(cmd);
+    if (fixed) return strdup(fixed);
 
-    CURL *curl;
-    CURLcode res;
-    struct MemoryStruct chunk;
-    chunk.memory = malloc(1);
-    chunk.size = 0;
-    if (!chunk.memory) return NULL;
-    chunk.memory[0] = '\0';
-
-    curl_global_init(CURL_GLOBAL_ALL);
-    curl = curl_easy_init();
-    if (!curl) {
-        free(chunk.memory);
-        curl_global_cleanup();
-        return NULL;
+    // Answers for the same binary and model are cached on disk, which also
+    // skips the --help fork below.
+    char *cached = desc_cache_lookup(cmd, OLLAMA_MODEL);
+    if (cached) {
+        if (on_token) on_token(cached, strlen(cached), user);
+        return cached;
     }
 
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-
     // Collect a small help snippet to ground the model (reduces hallucinations).
     // We intentionally limit the amount of text.
     char help_snippet[1200];
     help_snippet[0] = '\0';
     {
         char cmdline[512];
-        snprintf(cmdline, sizeof(cmdline), "%s --help 2>&1", cmd);
+        // stdin from /dev/null: this may run on the worker while the line
+        // editor reads the terminal, and some programs ignore --help and
+        // wait for input instead
+        snprintf(cmdline, sizeof(cmdline), "%s --help </dev/null 2>&1", cmd);
         FILE *fp = popen(cmdline, "r");
         if (fp) {
             size_t total = 0;
@@ -825,58 +1059,9 @@ static char* get_ollama_command_description(const char* cmd) {
              cmd,
              (help_snippet[0] ? help_snippet : "(no help output)"));
 
-    char *escaped_prompt = escape_json_string(full_prompt);
-    if (!escaped_prompt) {
-        free(chunk.memory);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return NULL;
-    }
-
-    char json_data[2048];
-    snprintf(json_data, sizeof(json_data),
-             "{\"model\": \"tinyllama\", \"prompt\": \"%s\", \"stream\": false, "
-             "\"temperature\": 0.1, \"top_p\": 0.5, \"top_k\": 20, \"num_predict\": 80}",
-             escaped_prompt);
-    free(escaped_prompt);
-
-    curl_easy_setopt(curl, CURLOPT_URL, OLLAMA_API_URL);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_data);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&chunk);
-
-    res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        free(chunk.memory);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return NULL;
-    }
-
-    struct json_object *parsed_json = json_tokener_parse(chunk.memory);
-    if (!parsed_json) {
-        free(chunk.memory);
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-        return NULL;
-    }
-
-    struct json_object *response_obj;
-    char *result = NULL;
-    if (json_object_object_get_ex(parsed_json, "response", &response_obj)) {
-        const char *response_text = json_object_get_string(response_obj);
-        result = strdup(response_text);
-    }
-
-    json_object_put(parsed_json);
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
-    free(chunk.memory);
-    curl_global_cleanup();
+    // Expected reply: Does:/Example:/Example:
+    char *result = ollama_generate(full_prompt, 80, 3, on_token, user);
+    if (result) desc_cache_store(cmd, OLLAMA_MODEL, result);
     return result;
 }
 
@@ -899,135 +1084,382 @@ static void print_first_n_nonempty_lines(const char *text, int n) {
         while (t > p && (*(t - 1) == ' ' || *(t - 1) == '\t')) t--;
 
         if (t > p) {
-            printf("%.*s\n", (int)(t - p), p);
+            term_printf("%.*s\n", (int)(t - p), p);
             printed++;
         }
         p = e;
     }
 }
 
+// Live renderer for streamed AI text. Blank lines and leading indentation
+// are dropped the same way print_first_n_nonempty_lines does. Text goes to
+// stdout, or into out when it is set (background lookups).
+typedef struct {
+    int at_line_start;
+    int printed;
+    struct MemoryStruct *out;
+} StreamRender;
+
+static void render_stream_token(const char *tok, size_t len, void *user) {
+    StreamRender *r = (StreamRender *)user;
+    for (size_t i = 0; i < len; i++) {
+        char c = tok[i];
+        if (c == '\r') continue;
+        if (r->at_line_start) {
+            if (c == '\n' || c == ' ' || c == '\t') continue;
+            r->at_line_start = 0;
+        }
+        if (r->out) {
+            memory_append(r->out, &c, 1);
+        } else {
+            term_putc(c);
+        }
+        r->printed = 1;
+        if (c == '\n') r->at_line_start = 1;
+    }
+    if (!r->out) term_flush();
+}
+
+// Stream a command description, falling back to the returned text when
+// nothing was rendered live (deterministic descriptions).
+static void print_command_description(const char *cmd) {
+    StreamRender r = { 1, 0, NULL };
+    char *desc = get_ollama_command_description(cmd, render_stream_token, &r);
+    if (r.printed) {
+        if (!r.at_line_start) term_puts("\n");
+    } else if (desc) {
+        print_first_n_nonempty_lines(desc, 3);
+    }
+    free(desc);
+}
+
+// ---------------------------------------------------------------------------
+// Background AI lookups.
+// A single worker thread owns the Ollama client and runs one job at a time.
+// Submitting a job replaces any queued one, and submitting or cancelling
+// bumps the generation so a running transfer is aborted from the curl
+// progress callback. Streamed text is collected under the lock and the line
+// editor is woken through a pipe; it pulls whole lines with ai_async_take().
+// ---------------------------------------------------------------------------
+
+static void ai_notify(void) {
+    char b = 1;
+    if (g_ai.notify_fd[1] >= 0 && write(g_ai.notify_fd[1], &b, 1) < 0) {
+        // Pipe full: the reader is already due to wake up.
+    }
+}
+
+// Drop the output of the previous job. Caller holds the lock.
+static void ai_reset_output(void) {
+    g_ai.out.size = 0;
+    if (g_ai.out.memory) g_ai.out.memory[0] = '\0';
+    g_ai.out_taken = 0;
+    g_ai.out_done = 0;
+    g_ai.out_failed = 0;
+    g_ai.out_labelled = 0;
+    g_ai.out_line_start = 1;
+}
+
+static void ai_async_token(const char *tok, size_t len, void *user) {
+    unsigned long gen = *(const unsigned long *)user;
+    pthread_mutex_lock(&g_ai.lock);
+    int current = (g_ai.gen == gen);
+    if (current) memory_append(&g_ai.out, tok, len);
+    pthread_mutex_unlock(&g_ai.lock);
+    if (current) ai_notify();
+}
+
+static void *ai_worker_main(void *arg) {
+    pthread_mutex_lock(&g_ai.lock);
+    while (!g_ai.stopping) {
+        if (!g_ai.has_job) {
+            pthread_cond_wait(&g_ai.wake, &g_ai.lock);
+            continue;
+        }
+
+        AiJobKind kind = g_ai.kind;
+        char text[sizeof(g_ai.text)];
+        memcpy(text, g_ai.text, sizeof(text));
+        unsigned long gen = g_ai.gen;
+        g_ai.has_job = 0;
+        g_ai.running_gen = gen;
+        pthread_mutex_unlock(&g_ai.lock);
+
+        char *result = (kind == AI_JOB_COMPLETION)
+            ? get_ollama_completion_stream(text, ai_async_token, &gen)
+            : get_ollama_command_description(text, ai_async_token, &gen);
+
+        pthread_mutex_lock(&g_ai.lock);
+        if (g_ai.gen == gen) {
+            g_ai.out_done = 1;
+            g_ai.out_failed = (result == NULL);
+            // g_ollama belongs to this thread; the editor reads the copy
+            snprintf(g_ai.out_error, sizeof(g_ai.out_error), "%s",
+                     g_ollama.last_error ? g_ollama.last_error : "no response");
+        }
+        pthread_mutex_unlock(&g_ai.lock);
+        free(result);
+        ai_notify();
+        pthread_mutex_lock(&g_ai.lock);
+    }
+    pthread_mutex_unlock(&g_ai.lock);
+    return NULL;
+}
+
+int ai_async_start(void) {
+    if (g_ai.started) return 1;
+    if (pipe(g_ai.notify_fd) != 0) return 0;
+    for (int i = 0; i < 2; i++) {
+        fcntl(g_ai.notify_fd[i], F_SETFL, fcntl(g_ai.notify_fd[i], F_GETFL) | O_NONBLOCK);
+        fcntl(g_ai.notify_fd[i], F_SETFD, FD_CLOEXEC);
+    }
+    g_ai.out.memory = malloc(1);
+    if (!g_ai.out.memory) return 0;
+    ai_reset_output();
+
+    pthread_mutex_lock(&g_ai.lock);
+    int err = pthread_create(&g_ai.thread, NULL, ai_worker_main, NULL);
+    g_ai.started = err == 0;
+    pthread_mutex_unlock(&g_ai.lock);
+    if (err != 0) {
+        close(g_ai.notify_fd[0]);
+        close(g_ai.notify_fd[1]);
+        g_ai.notify_fd[0] = g_ai.notify_fd[1] = -1;
+        return 0;
+    }
+    return 1;
+}
+
+void ai_async_stop(void) {
+    if (!g_ai.started) return;
+    pthread_mutex_lock(&g_ai.lock);
+    g_ai.stopping = 1;
+    g_ai.gen++;
+    pthread_cond_signal(&g_ai.wake);
+    pthread_mutex_unlock(&g_ai.lock);
+    pthread_join(g_ai.thread, NULL);
+
+    close(g_ai.notify_fd[0]);
+    close(g_ai.notify_fd[1]);
+    g_ai.notify_fd[0] = g_ai.notify_fd[1] = -1;
+    free(g_ai.out.memory);
+    g_ai.out.memory = NULL;
+    pthread_mutex_lock(&g_ai.lock);
+    g_ai.started = 0;
+    pthread_mutex_unlock(&g_ai.lock);
+}
+
+// Queue a lookup, replacing whatever was queued or running.
+// Returns 0 when no worker is running (caller should fall back to a
+// synchronous lookup).
+static int ai_async_submit(AiJobKind kind, const char *text) {
+    if (!g_ai.started) return 0;
+    pthread_mutex_lock(&g_ai.lock);
+    g_ai.gen++;
+    g_ai.has_job = 1;
+    g_ai.kind = kind;
+    snprintf(g_ai.text, sizeof(g_ai.text), "%s", text);
+    ai_reset_output();
+    pthread_cond_signal(&g_ai.wake);
+    pthread_mutex_unlock(&g_ai.lock);
+    return 1;
+}
+
+void ai_async_cancel(void) {
+    if (!g_ai.started) return;
+    pthread_mutex_lock(&g_ai.lock);
+    g_ai.gen++;
+    g_ai.has_job = 0;
+    ai_reset_output();
+    pthread_mutex_unlock(&g_ai.lock);
+}
+
+int ai_async_fd(void) {
+    return g_ai.started ? g_ai.notify_fd[0] : -1;
+}
+
+// Collect AI output that is ready to show: complete lines only while the
+// job is still running, everything once it finished. Returns a malloc'd
+// string for the line editor to print above the prompt, or NULL.
+char *ai_async_take(void) {
+    char drain[64];
+    while (read(g_ai.notify_fd[0], drain, sizeof(drain)) > 0) {}
+
+    struct MemoryStruct text;
+    text.memory = malloc(1);
+    text.size = 0;
+    if (!text.memory) return NULL;
+    text.memory[0] = '\0';
+
+    pthread_mutex_lock(&g_ai.lock);
+    size_t end = g_ai.out.size;
+    if (!g_ai.out_done) {
+        while (end > g_ai.out_taken && g_ai.out.memory[end - 1] != '\n') end--;
+    }
+    if (end > g_ai.out_taken) {
+        if (!g_ai.out_labelled) {
+            const char *label = "\033[1;96m⚡ Ollama:\033[0m\n";
+            memory_append(&text, label, strlen(label));
+            g_ai.out_labelled = 1;
+        }
+        StreamRender r = { g_ai.out_line_start, 0, &text };
+        render_stream_token(g_ai.out.memory + g_ai.out_taken, end - g_ai.out_taken, &r);
+        g_ai.out_line_start = r.at_line_start;
+        g_ai.out_taken = end;
+    }
+    if (g_ai.out_done) {
+        if (!g_ai.out_line_start) {
+            memory_append(&text, "\n", 1);
+            g_ai.out_line_start = 1;
+        }
+        if (g_ai.out_failed) {
+            char msg[256];
+            snprintf(msg, sizeof(msg),
+                     "Unable to get AI suggestions (%s). Is Ollama running?\n"
+                     "Try: ollama serve\n",
+                     g_ai.out_error);
+            memory_append(&text, msg, strlen(msg));
+        }
+        // Report completion only once.
+        g_ai.out_done = 0;
+        g_ai.out_failed = 0;
+    }
+    pthread_mutex_unlock(&g_ai.lock);
+
+    if (text.size == 0) {
+        free(text.memory);
+        return NULL;
+    }
+    return text.memory;
+}
+
+// Describe an external command: deterministic text right away, otherwise a
+// background Ollama lookup whose answer appears above the prompt.
+static void describe_external_command(const char *cmd) {
+    const char *fixed = fixed_command_description(cmd);
+    if (fixed) {
+        print_first_n_nonempty_lines(fixed, 3);
+        return;
+    }
+    if (ai_async_submit(AI_JOB_DESCRIPTION, cmd)) {
+        term_printf("Asking Ollama about '%s' in the background (keep typing)...\n", cmd);
+        return;
+    }
+    term_flush();   // show what we have before blocking on the model
+    print_command_description(cmd);
+}
+
 // Function to suggest next command based on prompt
 void suggest_command(const char* partial_cmd) {
-    printf("\n");
-    printf("\033[1;93m╔══════════════════════════════════════════════════════════════════╗\033[0m\n");
-    printf("\033[1;93m║\033[0m  \033[1;96m⚡ AI Suggestions for:\033[0m \033[1;95m'%s'\033[0m\033[1;93m                              ║\033[0m\n", partial_cmd ? partial_cmd : "");
-    printf("\033[1;93m╚══════════════════════════════════════════════════════════════════╝\033[0m\n\n");
+    term_puts("\n"
+              TERM_YELLOW "╔══════════════════════════════════════════════════════════════════╗" TERM_RESET "\n"
+              TERM_YELLOW "║" TERM_RESET "  " TERM_CYAN "⚡ AI Suggestions for:" TERM_RESET " " TERM_PINK "'");
+    term_puts(partial_cmd ? partial_cmd : "");
+    term_puts("'" TERM_RESET TERM_YELLOW "                              ║" TERM_RESET "\n"
+              TERM_YELLOW "╚══════════════════════════════════════════════════════════════════╝" TERM_RESET "\n\n");
 
     // If empty input, show the list of available commands
     if (!partial_cmd || !*partial_cmd) {
         print_match_list("");
-        printf("\n");
+        term_puts("\n");
         return;
     }
 
     // Built-in match logic (deterministic)
-    const BuiltinHelp *exact = find_help_exact_icase(partial_cmd);
+    const Builtin *exact = builtin_find_icase(partial_cmd);
     if (exact) {
         print_help_page(exact);
-        printf("\n");
+        term_puts("\n");
         return;
     }
 
     // Count prefix matches
     int match_count = 0;
-    const BuiltinHelp *single = NULL;
-    for (size_t i = 0; i < sizeof(BUILTIN_HELP)/sizeof(BUILTIN_HELP[0]); i++) {
-        if (starts_with_icase(BUILTIN_HELP[i].name, partial_cmd)) {
-            match_count++;
-            single = &BUILTIN_HELP[i];
-        }
+    const Builtin *single = NULL;
+    for (size_t i = builtin_prefix_start(partial_cmd);
+         i < BUILTIN_COUNT && starts_with_icase(BUILTINS[i].name, partial_cmd); i++) {
+        match_count++;
+        single = &BUILTINS[i];
     }
 
     if (match_count == 1 && single) {
         print_help_page(single);
-        printf("\n");
+        term_puts("\n");
         return;
     }
 
     if (match_count > 1) {
         print_match_list(partial_cmd);
-        printf("\n");
+        term_puts("\n");
         return;
     }
 
     // External commands from PATH (deterministic)
-    char ext_names[32][256];
-    int ext_n = collect_path_executables_with_prefix(partial_cmd, ext_names, 32);
-    if (ext_n == 1) {
-        printf("External command: %s\n", ext_names[0]);
-        char *desc = get_ollama_command_description(ext_names[0]);
-        if (desc) {
-            print_first_n_nonempty_lines(desc, 3);
-            free(desc);
-        }
-        printf("\nTip: type more arguments after it, e.g. \"%s --help\"\n\n", ext_names[0]);
+    CandidateList *ext = collect_path_executables_with_prefix(partial_cmd);
+    if (ext->count == 1) {
+        const char *name = ext->items[0].name;
+        term_printf("External command: %s\n", name);
+        describe_external_command(name);
+        term_printf("\nTip: type more arguments after it, e.g. \"%s --help\"\n\n", name);
         return;
     }
-    if (ext_n > 1) {
-        int best = pick_best_external_candidate(ext_names, ext_n);
+    if (ext->count > 1) {
+        int best = pick_best_external_candidate(ext);
         if (best >= 0) {
-            printf("Best match: %s\n\n", ext_names[best]);
-            char *desc = get_ollama_command_description(ext_names[best]);
-            if (desc) {
-                print_first_n_nonempty_lines(desc, 3);
-                printf("\n");
-                free(desc);
-            }
+            term_printf("Best match: %s\n\n", ext->items[best].name);
+            describe_external_command(ext->items[best].name);
+            term_puts("\n");
         }
-        printf("Possible external commands for '%s':\n", partial_cmd);
-        for (int i = 0; i < ext_n && i < 15; i++) {
-            printf("  %s\n", ext_names[i]);
+        const Candidate *top[15];
+        int shown = rank_top_candidates(ext, top, 15);
+        term_printf("Possible external commands for '%s':\n", partial_cmd);
+        for (int i = 0; i < shown; i++) {
+            term_printf("  %s\n", top[i]->name);
         }
-        if (ext_n > 15) {
-            printf("  ... (%d more)\n", ext_n - 15);
+        if (ext->count > shown) {
+            term_printf("  ... (%d more)\n", ext->count - shown);
         }
-        printf("\nTip: keep typing to narrow it down.\n\n");
+        term_puts("\nTip: keep typing to narrow it down.\n\n");
         return;
     }
 
-    // Fallback to Ollama only when no built-in or PATH matches exist
-    printf("No built-in or PATH match for '%s'. Asking Ollama...\n\n", partial_cmd);
-    char* ai_suggestion = get_ollama_completion(partial_cmd);
+    // Fuzzy matches over builtins, PATH and history (e.g. gtst -> git status)
+    FuzzySearch fs;
+    fuzzy_search(partial_cmd, &fs);
+    if (fs.count > 0) {
+        term_printf("Fuzzy matches for '%s':\n", partial_cmd);
+        for (int i = 0; i < fs.count; i++) {
+            term_printf("  %-28s (%s)\n", fs.top[i].text, fs.top[i].source);
+        }
+        if (fs.total > fs.count) {
+            term_printf("  ... (%d more)\n", fs.total - fs.count);
+        }
+        // complete_line() puts an untied best match on the line right away
+        if (fuzzy_best_is_tied(&fs)) {
+            term_puts("\nTip: keep typing to pick one.\n\n");
+        } else {
+            term_puts("\nThe first match is now on the command line.\n\n");
+        }
+        return;
+    }
+
+    // Fallback to Ollama only when no built-in, PATH or fuzzy matches exist
+    if (ai_async_submit(AI_JOB_COMPLETION, partial_cmd)) {
+        term_printf("No built-in or PATH match for '%s'. Asking Ollama in the background (keep typing)...\n\n", partial_cmd);
+        return;
+    }
+    // No worker thread, so g_ollama is only touched from here
+    term_printf("No built-in or PATH match for '%s'. Asking Ollama...\n\n", partial_cmd);
+    term_flush();
+    StreamRender r = { 1, 0, NULL };
+    char* ai_suggestion = get_ollama_completion_stream(partial_cmd, render_stream_token, &r);
     if (ai_suggestion) {
-        printf("%s\n\n", ai_suggestion);
+        term_puts(r.at_line_start ? "\n" : "\n\n");
         free(ai_suggestion);
     } else {
-        printf("Unable to get AI suggestions. Is Ollama running?\n");
-        printf("Try: ollama serve\n");
-        printf("Ensure model is installed: ollama pull tinyllama\n\n");
+        term_printf("Unable to get AI suggestions (%s). Is Ollama running?\n",
+                    g_ollama.last_error ? g_ollama.last_error : "no response");
+        term_puts("Try: ollama serve\n");
+        term_puts("Ensure model is installed: ollama pull tinyllama\n\n");
     }
 }
-
-// Split a line into tokens
-char **ripple_split_line(char *line) {
-    int bufsize = RIPPLE_TOK_BUFSIZE;
-    int position = 0;
-    char **tokens = malloc(bufsize * sizeof(char *));
-    char *token;
-
-    if (!tokens) {
-        fprintf(stderr, "ripple: allocation error\n");
-        return NULL;
-    }
-
-    token = strtok(line, RIPPLE_TOK_DELIM);
-    while (token != NULL) {
-        tokens[position] = token;
-        position++;
-
-        if (position >= bufsize) {
-            bufsize += RIPPLE_TOK_BUFSIZE;
-            char **temp = realloc(tokens, bufsize * sizeof(char *));
-            if (!temp) {
-                fprintf(stderr, "ripple: allocation error\n");
-                free(tokens);
-                return NULL;
-            }
-            tokens = temp;
-        }
-
-        token = strtok(NULL, RIPPLE_TOK_DELIM);
-    }
-    tokens[position] = NULL;
-    return tokens;
-} 
\ No newline at end of file
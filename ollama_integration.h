@@ -3,21 +3,36 @@
 
 #include <stddef.h>
 
+// Receives streamed model output as it arrives (not NUL-terminated)
+typedef void (*ollama_token_cb)(const char *token, size_t len, void *user);
+
+// Receives one history line at a time
+typedef void (*ripple_history_fn)(const char *line, void *user);
+
 // Function declarations
+int ollama_client_init(void);
+void ollama_client_cleanup(void);
+int ai_async_start(void);
+void ai_async_stop(void);
+void ai_async_cancel(void);
+int ai_async_fd(void);
+char* ai_async_take(void);
 char* get_ollama_completion(const char* prompt);
+char* get_ollama_completion_stream(const char* prompt, ollama_token_cb on_token, void *user);
 void suggest_command(const char* partial_cmd);
 int complete_builtin_command(const char* partial_cmd, char* out, size_t out_sz);
 int complete_external_command(const char* partial_cmd, char* out, size_t out_sz);
 void suggest_external_args(const char* cmd, const char* partial_arg);
 int complete_external_arg(const char* cmd, const char* partial_arg, char* out, size_t out_sz);
 char* ripple_read_line(void);
-char** ripple_split_line(char* line);
+void ripple_history_foreach(ripple_history_fn fn, void *user);
+int complete_fuzzy_command(const char* partial_cmd, char* out, size_t out_sz);
+const char* autosuggest_line(const char* line);
 
 // Constants
 #define RIPPLE_RL_BUFSIZE 1024
-#define RIPPLE_TOK_BUFSIZE 64
-#define RIPPLE_TOK_DELIM " \t\r\n\a"
 #define RIPPLE_VERSION "1.0.0"
 #define OLLAMA_API_URL "http://localhost:11434/api/generate"
+#define OLLAMA_MODEL "tinyllama"
 
 #endif // OLLAMA_INTEGRATION_H 
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    TOK_WORD,
+    TOK_PIPE,       // |
+    TOK_OR_IF,      // ||
+    TOK_AMP,        // &
+    TOK_AND_IF,     // &&
+    TOK_SEMI,       // ;
+    TOK_LESS,       // <
+    TOK_GREAT,      // >
+    TOK_DGREAT,     // >>
+    TOK_LESSAND,    // <&
+    TOK_GREATAND,   // >&
+    TOK_END
+} TokenKind;
+
+static const char *token_names[] = {
+    "word", "|", "||", "&", "&&", ";", "<", ">", ">>", "<&", ">&", "newline"
+};
+
+typedef struct {
+    TokenKind kind;
+    size_t start;   // TOK_WORD: unquoted text is line[start, start + len)
+    size_t len;
+    int io_fd;      // redirections: explicit descriptor ("2>"), else -1
+} Token;
+
+typedef struct {
+    Arena *arena;
+    char *line;
+    char *p;            // next unread character of the line
+    Token tok;          // lookahead
+    const char *error;
+} Parser;
+
+static char g_error[128];
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int is_meta(char c) {
+    return is_blank(c) || c == '|' || c == '&' || c == ';' || c == '<' || c == '>';
+}
+
+static int set_error(Parser *ps, const char *what) {
+    if (!ps->error) {
+        snprintf(g_error, sizeof(g_error), "%s", what);
+        ps->error = g_error;
+    }
+    return -1;
+}
+
+static int syntax_error(Parser *ps) {
+    char msg[sizeof(g_error)];
+    if (ps->tok.kind == TOK_WORD) {
+        snprintf(msg, sizeof(msg), "syntax error near `%.*s'",
+                 (int)ps->tok.len, ps->line + ps->tok.start);
+    } else {
+        snprintf(msg, sizeof(msg), "syntax error near `%s'", token_names[ps->tok.kind]);
+    }
+    return set_error(ps, msg);
+}
+
+// Read one word, removing quotes and backslashes in place: the unquoted text
+// is never longer than its source, so it is written over the line starting
+// at the word's first byte
+static int lex_word(Parser *ps) {
+    char *start = ps->p;
+    char *p = start;
+    char *out = start;
+
+    while (*p && !is_meta(*p)) {
+        if (*p == '\'') {
+            char *end = strchr(p + 1, '\'');
+            if (!end) return set_error(ps, "unterminated single quote");
+            memmove(out, p + 1, (size_t)(end - p - 1));
+            out += end - p - 1;
+            p = end + 1;
+        } else if (*p == '"') {
+            p++;
+            while (*p && *p != '"') {
+                // Inside double quotes a backslash only escapes these
+                if (*p == '\\' && p[1] && strchr("\"\\$`\n", p[1])) p++;
+                *out++ = *p++;
+            }
+            if (!*p) return set_error(ps, "unterminated double quote");
+            p++;
+        } else if (*p == '\\') {
+            p++;
+            if (*p) *out++ = *p++;
+        } else {
+            *out++ = *p++;
+        }
+    }
+
+    ps->tok.kind = TOK_WORD;
+    ps->tok.start = (size_t)(start - ps->line);
+    ps->tok.len = (size_t)(out - start);
+    ps->p = p;
+    return 0;
+}
+
+// NUL-terminate the current word where it lies. There is room whenever
+// quotes were removed or a blank or the end of the line follows it; only a
+// word glued to an operator ("a|b") has to be copied into the arena.
+static char *word_text(Parser *ps) {
+    char *s = ps->line + ps->tok.start;
+    char *end = s + ps->tok.len;
+
+    if (end < ps->p || is_blank(*end)) {
+        if (end == ps->p) ps->p++;
+        *end = '\0';
+        return s;
+    }
+    if (*end == '\0') return s;
+    s = arena_strndup(ps->arena, s, ps->tok.len);
+    if (!s) set_error(ps, "out of memory");
+    return s;
+}
+
+// Advance the lookahead token
+static int lex_next(Parser *ps) {
+    char *p = ps->p;
+    while (is_blank(*p)) p++;
+    if (*p == '#') p += strlen(p);
+
+    ps->tok.io_fd = -1;
+    if (!*p) {
+        ps->p = p;
+        ps->tok.kind = TOK_END;
+        return 0;
+    }
+
+    // Digits glued to a redirection operator name the descriptor: 2>err
+    char *d = p;
+    int fd = 0;
+    while (*d >= '0' && *d <= '9' && fd < 1000) fd = fd * 10 + (*d++ - '0');
+    if (d > p && (*d == '<' || *d == '>')) {
+        ps->tok.io_fd = fd;
+        p = d;
+    }
+
+    switch (*p) {
+    case '|':
+        ps->tok.kind = p[1] == '|' ? TOK_OR_IF : TOK_PIPE;
+        break;
+    case '&':
+        ps->tok.kind = p[1] == '&' ? TOK_AND_IF : TOK_AMP;
+        break;
+    case ';':
+        ps->tok.kind = TOK_SEMI;
+        break;
+    case '<':
+        ps->tok.kind = p[1] == '&' ? TOK_LESSAND : TOK_LESS;
+        break;
+    case '>':
+        ps->tok.kind = p[1] == '>' ? TOK_DGREAT : p[1] == '&' ? TOK_GREATAND : TOK_GREAT;
+        break;
+    default:
+        ps->p = p;
+        return lex_word(ps);
+    }
+    ps->p = p + strlen(token_names[ps->tok.kind]);
+    return 0;
+}
+
+// Grow an arena array by doubling; the old copy is simply left behind
+static void *grow(Parser *ps, void *items, int count, int *cap, size_t size) {
+    if (count < *cap) return items;
+    int new_cap = *cap ? *cap * 2 : 4;
+    void *bigger = arena_alloc(ps->arena, (size_t)new_cap * size);
+    if (!bigger) {
+        set_error(ps, "out of memory");
+        return NULL;
+    }
+    if (count) memcpy(bigger, items, (size_t)count * size);
+    *cap = new_cap;
+    return bigger;
+}
+
+static int parse_redirect(Parser *ps, Redirect *r) {
+    TokenKind op = ps->tok.kind;
+    int io_fd = ps->tok.io_fd;
+
+    memset(r, 0, sizeof(*r));
+    switch (op) {
+    case TOK_LESS:     r->kind = REDIR_IN; r->fd = 0; break;
+    case TOK_GREAT:    r->kind = REDIR_OUT; r->fd = 1; break;
+    case TOK_DGREAT:   r->kind = REDIR_APPEND; r->fd = 1; break;
+    case TOK_LESSAND:  r->kind = REDIR_DUP; r->fd = 0; break;
+    default:           r->kind = REDIR_DUP; r->fd = 1; break;
+    }
+    if (io_fd >= 0) r->fd = io_fd;
+
+    if (lex_next(ps) < 0) return -1;
+    if (ps->tok.kind != TOK_WORD) return syntax_error(ps);
+
+    char *s = word_text(ps);
+    if (!s) return -1;
+    if (r->kind == REDIR_DUP) {
+        char *end;
+        long target = strtol(s, &end, 10);
+        if (!*s || *end || target < 0 || target > 1000) {
+            char msg[sizeof(g_error)];
+            snprintf(msg, sizeof(msg), "%s: bad file descriptor", s);
+            return set_error(ps, msg);
+        }
+        r->dup_fd = (int)target;
+    } else {
+        r->path = s;
+    }
+    return lex_next(ps);
+}
+
+static int parse_command(Parser *ps, SimpleCommand *cmd) {
+    char **argv = NULL;
+    int argc = 0, cap = 0;
+    Redirect **tail = &cmd->redirects;
+
+    cmd->redirects = NULL;
+    for (;;) {
+        if (ps->tok.kind == TOK_WORD) {
+            if (!(argv = grow(ps, argv, argc, &cap, sizeof(char *)))) return -1;
+            if (!(argv[argc++] = word_text(ps))) return -1;
+            if (lex_next(ps) < 0) return -1;
+        } else if (ps->tok.kind >= TOK_LESS && ps->tok.kind <= TOK_GREATAND) {
+            Redirect *r = arena_alloc(ps->arena, sizeof(Redirect));
+            if (!r) return set_error(ps, "out of memory");
+            if (parse_redirect(ps, r) < 0) return -1;
+            *tail = r;
+            tail = &r->next;
+        } else {
+            break;
+        }
+    }
+
+    if (argc == 0 && !cmd->redirects) return syntax_error(ps);
+    if (!(argv = grow(ps, argv, argc, &cap, sizeof(char *)))) return -1;
+    argv[argc] = NULL;
+    cmd->argv = argv;
+    cmd->argc = argc;
+    return 0;
+}
+
+static int parse_pipeline(Parser *ps, Pipeline *pl) {
+    int cap = 0;
+    pl->commands = NULL;
+    pl->count = 0;
+    for (;;) {
+        if (!(pl->commands = grow(ps, pl->commands, pl->count, &cap, sizeof(SimpleCommand)))) return -1;
+        if (parse_command(ps, &pl->commands[pl->count]) < 0) return -1;
+        pl->count++;
+        if (ps->tok.kind != TOK_PIPE) return 0;
+        if (lex_next(ps) < 0) return -1;
+    }
+}
+
+static int parse_and_or(Parser *ps, AndOr *ao) {
+    int cap = 0, op_cap = 0;
+    AndOrOp op = AND_OR_NONE;
+
+    ao->pipelines = NULL;
+    ao->ops = NULL;
+    ao->count = 0;
+    ao->background = 0;
+    for (;;) {
+        if (!(ao->pipelines = grow(ps, ao->pipelines, ao->count, &cap, sizeof(Pipeline)))) return -1;
+        if (!(ao->ops = grow(ps, ao->ops, ao->count, &op_cap, sizeof(AndOrOp)))) return -1;
+        ao->ops[ao->count] = op;
+        if (parse_pipeline(ps, &ao->pipelines[ao->count]) < 0) return -1;
+        ao->count++;
+
+        if (ps->tok.kind == TOK_AND_IF) {
+            op = AND_OR_AND;
+        } else if (ps->tok.kind == TOK_OR_IF) {
+            op = AND_OR_OR;
+        } else {
+            return 0;
+        }
+        if (lex_next(ps) < 0) return -1;
+    }
+}
+
+CommandList* parse_command_line(Arena* arena, char* line, const char** error) {
+    Parser ps;
+    int cap = 0;
+
+    ps.arena = arena;
+    ps.line = line;
+    ps.p = line;
+    ps.error = NULL;
+    CommandList *list = arena_alloc(arena, sizeof(CommandList));
+    if (!list) {
+        set_error(&ps, "out of memory");
+        goto fail;
+    }
+    list->items = NULL;
+    list->count = 0;
+
+    if (lex_next(&ps) < 0) goto fail;
+    while (ps.tok.kind != TOK_END) {
+        if (!(list->items = grow(&ps, list->items, list->count, &cap, sizeof(AndOr)))) goto fail;
+        AndOr *ao = &list->items[list->count];
+        if (parse_and_or(&ps, ao) < 0) goto fail;
+        list->count++;
+
+        if (ps.tok.kind == TOK_SEMI || ps.tok.kind == TOK_AMP) {
+            ao->background = ps.tok.kind == TOK_AMP;
+            if (lex_next(&ps) < 0) goto fail;
+        } else if (ps.tok.kind != TOK_END) {
+            syntax_error(&ps);
+            goto fail;
+        }
+    }
+    return list;
+
+fail:
+    if (error) *error = ps.error;
+    return NULL;
+}
@@ -0,0 +1,65 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include "arena.h"
+
+// Command-line parser.
+// The lexer understands single and double quotes, backslash escapes, '#'
+// comments and the operators | || & && ; < > >> n< n> n>> n>&m. The parser
+// turns the tokens into
+//   list     = and_or { (';' | '&') and_or } [';' | '&']
+//   and_or   = pipeline { ('&&' | '||') pipeline }
+//   pipeline = command { '|' command }
+//   command  = { word | redirection }
+// Words are unquoted and NUL-terminated in place inside the line, so argv
+// entries point into it; the nodes live in the arena passed in. Both must
+// stay untouched while the result is in use.
+typedef enum {
+    REDIR_IN,       // n< path
+    REDIR_OUT,      // n> path
+    REDIR_APPEND,   // n>> path
+    REDIR_DUP       // n>&m
+} RedirectKind;
+
+typedef struct Redirect {
+    RedirectKind kind;
+    int fd;                 // descriptor being redirected
+    int dup_fd;             // REDIR_DUP: descriptor copied onto fd
+    const char *path;       // everything else: file name
+    struct Redirect *next;  // in source order
+} Redirect;
+
+typedef struct {
+    char **argv;            // NULL-terminated; argv[0] is NULL for "> file"
+    int argc;
+    Redirect *redirects;
+} SimpleCommand;
+
+typedef struct {
+    SimpleCommand *commands;
+    int count;
+} Pipeline;
+
+typedef enum {
+    AND_OR_NONE,            // first pipeline of the chain
+    AND_OR_AND,             // run only if the previous pipeline succeeded
+    AND_OR_OR               // run only if the previous pipeline failed
+} AndOrOp;
+
+typedef struct {
+    Pipeline *pipelines;
+    AndOrOp *ops;           // ops[i] joins pipelines[i - 1] and pipelines[i]
+    int count;
+    int background;         // terminated by '&'
+} AndOr;
+
+typedef struct {
+    AndOr *items;
+    int count;              // 0 for a blank line or a comment
+} CommandList;
+
+// Returns NULL on a syntax error and points *error at a message that stays
+// valid until the next call.
+CommandList* parse_command_line(Arena* arena, char* line, const char** error);
+
+#endif // PARSER_H
@@ -0,0 +1,427 @@
+#include "path_index.h"
+#include "fuzzy.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+typedef struct {
+    unsigned dir;       // index into dirs[]
+    unsigned name;      // offset of the NUL-terminated name in dirs[dir].pool
+    uint64_t mask;      // fuzzy_charmask() of the name, for prefiltering
+} PathEntry;
+
+typedef struct {
+    char *path;
+    long long mtime_ns; // mtime seen by the last scan (-1 = missing)
+    int scanned;
+    char *pool;         // names found by the last scan
+    PathEntry *entries; // this directory's entries, sorted
+    size_t count;
+} PathDir;
+
+// Result of scanning one directory, built without holding the lock
+typedef struct {
+    long long mtime_ns;
+    char *pool;
+    size_t pool_len;
+    size_t pool_cap;
+    PathEntry *entries;
+    size_t count;
+    size_t cap;
+} DirScan;
+
+static struct {
+    pthread_mutex_t lock;
+    unsigned long gen;  // bumped whenever dirs[] is replaced
+    char *path_env;     // $PATH the index was built from
+    PathDir *dirs;
+    int ndirs;
+    PathEntry *entries; // all directories merged; duplicates kept, earlier dir first
+    size_t count;
+} g_index = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static long long stat_mtime_ns(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+#ifdef __APPLE__
+    return (long long)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    return (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+}
+
+// Case-insensitive order; prefix matches form one contiguous range in it.
+static int icase_cmp(const char *a, const char *b) {
+    while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return tolower((unsigned char)*a) - tolower((unsigned char)*b);
+}
+
+// Compare only the first strlen(prefix) characters of name.
+static int icase_prefix_cmp(const char *name, const char *prefix) {
+    for (; *prefix; name++, prefix++) {
+        if (!*name) return -1;
+        int diff = tolower((unsigned char)*name) - tolower((unsigned char)*prefix);
+        if (diff) return diff;
+    }
+    return 0;
+}
+
+static int compare_names(const char *a, const char *b) {
+    int c = icase_cmp(a, b);
+    return c ? c : strcmp(a, b);
+}
+
+static const char *entry_name(const PathEntry *e) {
+    return g_index.dirs[e->dir].pool + e->name;
+}
+
+// qsort has no context argument; the scan being sorted is passed here
+// (per thread, since the indexer and the shell may sort at the same time).
+static _Thread_local const char *g_sort_pool;
+
+static int compare_scan_entries(const void *a, const void *b) {
+    return compare_names(g_sort_pool + ((const PathEntry *)a)->name,
+                         g_sort_pool + ((const PathEntry *)b)->name);
+}
+
+static int scan_add(DirScan *scan, const char *name, unsigned dir) {
+    size_t len = strlen(name) + 1;
+    if (scan->pool_len + len > scan->pool_cap) {
+        size_t cap = scan->pool_cap ? scan->pool_cap * 2 : 4096;
+        while (cap < scan->pool_len + len) cap *= 2;
+        char *temp = realloc(scan->pool, cap);
+        if (!temp) return 0;
+        scan->pool = temp;
+        scan->pool_cap = cap;
+    }
+    if (scan->count >= scan->cap) {
+        size_t cap = scan->cap ? scan->cap * 2 : 256;
+        PathEntry *temp = realloc(scan->entries, cap * sizeof(PathEntry));
+        if (!temp) return 0;
+        scan->entries = temp;
+        scan->cap = cap;
+    }
+
+    memcpy(scan->pool + scan->pool_len, name, len);
+    scan->entries[scan->count].dir = dir;
+    scan->entries[scan->count].name = (unsigned)scan->pool_len;
+    scan->entries[scan->count].mask = fuzzy_charmask(name);
+    scan->pool_len += len;
+    scan->count++;
+    return 1;
+}
+
+// List the executables in one PATH directory. File types come from d_type
+// when the filesystem provides it; fstatat() on the directory fd is only
+// needed for symlinks / unknown types. faccessat() keeps what we may
+// actually execute, not just anything with an x bit.
+static void scan_dir(const char *path, unsigned dir, DirScan *scan) {
+    memset(scan, 0, sizeof(*scan));
+    scan->mtime_ns = stat_mtime_ns(path);
+
+    DIR *d = opendir(path);
+    if (!d) return;
+    int fd = dirfd(d);
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        const char *name = ent->d_name;
+        if (name[0] == '.') continue;
+#ifdef DT_DIR
+        if (ent->d_type == DT_DIR || ent->d_type == DT_FIFO || ent->d_type == DT_SOCK ||
+            ent->d_type == DT_CHR || ent->d_type == DT_BLK) {
+            continue;
+        }
+#endif
+        int regular = 0;
+#ifdef DT_REG
+        regular = ent->d_type == DT_REG;
+#endif
+        struct stat st;
+        if (!regular && (fstatat(fd, name, &st, 0) != 0 || !S_ISREG(st.st_mode))) continue;
+        if (faccessat(fd, name, X_OK, AT_EACCESS) != 0) continue;
+        if (!scan_add(scan, name, dir)) break;
+    }
+    closedir(d);
+
+    g_sort_pool = scan->pool;
+    qsort(scan->entries, scan->count, sizeof(PathEntry), compare_scan_entries);
+}
+
+// Replace the entries of dirs[i] with a fresh scan. Caller holds the lock.
+static void install_scan(int i, DirScan *scan) {
+    PathDir *pd = &g_index.dirs[i];
+
+    // Drop the old entries of this directory from the merged array
+    size_t kept = 0;
+    for (size_t k = 0; k < g_index.count; k++) {
+        if (g_index.entries[k].dir != (unsigned)i) g_index.entries[kept++] = g_index.entries[k];
+    }
+    g_index.count = kept;
+
+    free(pd->pool);
+    free(pd->entries);
+    pd->pool = scan->pool;
+    pd->entries = scan->entries;
+    pd->count = scan->count;
+    pd->mtime_ns = scan->mtime_ns;
+    pd->scanned = 1;
+
+    // Merge the sorted scan into the sorted merged array
+    PathEntry *merged = malloc((g_index.count + pd->count + 1) * sizeof(PathEntry));
+    if (!merged) return;
+    size_t a = 0, b = 0, n = 0;
+    while (a < g_index.count || b < pd->count) {
+        if (b == pd->count) {
+            merged[n++] = g_index.entries[a++];
+        } else if (a == g_index.count) {
+            merged[n++] = pd->entries[b++];
+        } else {
+            int c = compare_names(entry_name(&g_index.entries[a]), entry_name(&pd->entries[b]));
+            if (c < 0 || (c == 0 && g_index.entries[a].dir < pd->entries[b].dir)) {
+                merged[n++] = g_index.entries[a++];
+            } else {
+                merged[n++] = pd->entries[b++];
+            }
+        }
+    }
+    free(g_index.entries);
+    g_index.entries = merged;
+    g_index.count = n;
+}
+
+static void free_scan(DirScan *scan) {
+    free(scan->pool);
+    free(scan->entries);
+}
+
+// Start over for a new $PATH value. Caller holds the lock.
+static void reset_dirs(const char *path_env) {
+    for (int i = 0; i < g_index.ndirs; i++) {
+        free(g_index.dirs[i].path);
+        free(g_index.dirs[i].pool);
+        free(g_index.dirs[i].entries);
+    }
+    free(g_index.dirs);
+    free(g_index.entries);
+    free(g_index.path_env);
+    g_index.dirs = NULL;
+    g_index.ndirs = 0;
+    g_index.entries = NULL;
+    g_index.count = 0;
+    g_index.path_env = strdup(path_env);
+    g_index.gen++;
+
+    char *path_copy = strdup(path_env);
+    if (!path_copy) return;
+    int cap = 8;
+    g_index.dirs = calloc(cap, sizeof(PathDir));
+    char *saveptr = NULL;
+    for (char *dir = strtok_r(path_copy, ":", &saveptr); dir && g_index.dirs;
+         dir = strtok_r(NULL, ":", &saveptr)) {
+        if (g_index.ndirs >= cap) {
+            PathDir *temp = realloc(g_index.dirs, cap * 2 * sizeof(PathDir));
+            if (!temp) break;
+            memset(temp + cap, 0, cap * sizeof(PathDir));
+            g_index.dirs = temp;
+            cap *= 2;
+        }
+        g_index.dirs[g_index.ndirs].path = strdup(dir);
+        if (g_index.dirs[g_index.ndirs].path) g_index.ndirs++;
+    }
+    free(path_copy);
+}
+
+// Bring the index up to date for the current $PATH: scan directories the
+// background thread has not reached yet and rescan those whose mtime moved.
+// Caller holds the lock.
+static void refresh_locked(void) {
+    const char *path_env = getenv("PATH");
+    if (!path_env) path_env = "";
+    if (!g_index.path_env || strcmp(g_index.path_env, path_env) != 0) {
+        reset_dirs(path_env);
+    }
+
+    for (int i = 0; i < g_index.ndirs; i++) {
+        PathDir *pd = &g_index.dirs[i];
+        if (pd->scanned && stat_mtime_ns(pd->path) == pd->mtime_ns) continue;
+        DirScan scan;
+        scan_dir(pd->path, (unsigned)i, &scan);
+        install_scan(i, &scan);
+    }
+}
+
+static void *background_main(void *arg) {
+#ifdef __linux__
+    // On Linux the nice value is per thread, so this only slows the indexer
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#elif defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#endif
+
+    pthread_mutex_lock(&g_index.lock);
+    const char *path_env = getenv("PATH");
+    if (!g_index.path_env) reset_dirs(path_env ? path_env : "");
+
+    for (int i = 0; i < g_index.ndirs; i++) {
+        if (g_index.dirs[i].scanned) continue;
+        unsigned long gen = g_index.gen;
+        char *path = strdup(g_index.dirs[i].path);
+        pthread_mutex_unlock(&g_index.lock);
+
+        // Scan without the lock so TAB is never stuck behind the indexer
+        DirScan scan;
+        if (path) scan_dir(path, (unsigned)i, &scan);
+        free(path);
+
+        pthread_mutex_lock(&g_index.lock);
+        if (!path) break;
+        if (g_index.gen != gen) {
+            // PATH changed under us; queries take over
+            free_scan(&scan);
+            break;
+        }
+        if (!g_index.dirs[i].scanned) {
+            install_scan(i, &scan);
+        } else {
+            free_scan(&scan);
+        }
+    }
+    pthread_mutex_unlock(&g_index.lock);
+    return NULL;
+}
+
+// fork() copies the lock but not the indexer thread. Holding it across the
+// fork means a child that goes on to path_index_lookup() (a background job
+// or a builtin pipeline stage) never finds it locked by a thread it lacks.
+static void fork_prepare(void) {
+    pthread_mutex_lock(&g_index.lock);
+}
+
+static void fork_release(void) {
+    pthread_mutex_unlock(&g_index.lock);
+}
+
+// Start filling the index in the background. Returns 0 if no thread could
+// be created (queries then scan on demand).
+int path_index_start_background(void) {
+    static int atfork_registered;
+    if (!atfork_registered) {
+        atfork_registered = pthread_atfork(fork_prepare, fork_release, fork_release) == 0;
+    }
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, background_main, NULL) != 0) return 0;
+    pthread_detach(thread);
+    return 1;
+}
+
+// Prefix query over what is indexed now. Caller holds the lock.
+static size_t for_prefix_locked(const char *prefix, path_index_visit_fn visit, void *user) {
+    size_t lo = 0, hi = g_index.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (icase_prefix_cmp(entry_name(&g_index.entries[mid]), prefix) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    size_t visited = 0;
+    const char *prev = NULL;
+    for (size_t i = lo; i < g_index.count; i++) {
+        const PathEntry *e = &g_index.entries[i];
+        const char *name = entry_name(e);
+        if (icase_prefix_cmp(name, prefix) != 0) break;
+        if (prev && strcmp(prev, name) == 0) continue;
+        prev = name;
+        if (visit) visit(name, g_index.dirs[e->dir].path, user);
+        visited++;
+    }
+    return visited;
+}
+
+// Visit every executable whose name starts with prefix (case-insensitive),
+// in index order, once per name (the earliest PATH directory wins).
+// Returns the number of names visited. The name and dir pointers are only
+// valid during the callback.
+size_t path_index_for_prefix(const char* prefix, path_index_visit_fn visit, void* user) {
+    if (!prefix) prefix = "";
+    pthread_mutex_lock(&g_index.lock);
+    refresh_locked();
+    size_t visited = for_prefix_locked(prefix, visit, user);
+    pthread_mutex_unlock(&g_index.lock);
+    return visited;
+}
+
+// Same, over only what is already indexed: no stat of the PATH directories
+// and no scan of the ones the indexer has not reached. For callers on the
+// keystroke path, which must not wait for the disk.
+size_t path_index_for_prefix_indexed(const char* prefix, path_index_visit_fn visit, void* user) {
+    if (!prefix) prefix = "";
+    pthread_mutex_lock(&g_index.lock);
+    size_t visited = for_prefix_locked(prefix, visit, user);
+    pthread_mutex_unlock(&g_index.lock);
+    return visited;
+}
+
+// Resolve a command name the way execvp would, without walking $PATH:
+// the first PATH directory holding an executable of exactly that name wins.
+// Answers from the index as it stands, so spawning never waits on a scan;
+// entries that are gone or not executable by us are passed over. Writes
+// "dir/name" to out and returns 1, or returns 0 and the caller searches
+// $PATH itself.
+int path_index_lookup(const char* name, char* out, size_t out_sz) {
+    int found = 0;
+
+    pthread_mutex_lock(&g_index.lock);
+    size_t lo = 0, hi = g_index.count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (compare_names(entry_name(&g_index.entries[mid]), name) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    // Equal names sort by directory, so candidates come in PATH order
+    for (; !found && lo < g_index.count && strcmp(entry_name(&g_index.entries[lo]), name) == 0; lo++) {
+        const PathEntry *e = &g_index.entries[lo];
+        int n = snprintf(out, out_sz, "%s/%s", g_index.dirs[e->dir].path, name);
+        found = n > 0 && (size_t)n < out_sz && faccessat(AT_FDCWD, out, X_OK, AT_EACCESS) == 0;
+    }
+    pthread_mutex_unlock(&g_index.lock);
+    return found;
+}
+
+// Visit every executable whose character mask covers need (see
+// fuzzy_charmask), once per name. Used as the prefilter for fuzzy search.
+size_t path_index_for_mask(uint64_t need, path_index_visit_fn visit, void* user) {
+    pthread_mutex_lock(&g_index.lock);
+    refresh_locked();
+
+    size_t visited = 0;
+    const char *prev = NULL;
+    for (size_t i = 0; i < g_index.count; i++) {
+        const PathEntry *e = &g_index.entries[i];
+        if ((e->mask & need) != need) continue;
+        const char *name = entry_name(e);
+        if (prev && strcmp(prev, name) == 0) continue;
+        prev = name;
+        if (visit) visit(name, g_index.dirs[e->dir].path, user);
+        visited++;
+    }
+    pthread_mutex_unlock(&g_index.lock);
+    return visited;
+}
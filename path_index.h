@@ -0,0 +1,22 @@
+#ifndef PATH_INDEX_H
+#define PATH_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Index of the executables reachable through $PATH.
+// Names are kept in one sorted array (case-insensitive order) together with
+// the PATH directory each came from, so a prefix query is a binary search.
+// A low-priority thread fills the index at startup; queries scan any
+// directory it has not reached yet themselves, except the _indexed one
+// and path_index_lookup(), which answer from what is there. A directory is rescanned
+// only when its mtime changes, and everything when $PATH changes.
+typedef void (*path_index_visit_fn)(const char* name, const char* dir, void* user);
+
+int path_index_start_background(void);
+size_t path_index_for_prefix(const char* prefix, path_index_visit_fn visit, void* user);
+size_t path_index_for_prefix_indexed(const char* prefix, path_index_visit_fn visit, void* user);
+size_t path_index_for_mask(uint64_t need, path_index_visit_fn visit, void* user);
+int path_index_lookup(const char* name, char* out, size_t out_sz);
+
+#endif // PATH_INDEX_H
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE   // pipe2
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -12,7 +13,26 @@
 #include <sys/stat.h> // For mkdir, touch
 #include <curl/curl.h> // For Ollama API calls
 #include <termios.h>  // For raw terminal mode
+#include <poll.h>     // For waiting on keys and AI output together
+#include <fcntl.h>    // For redirections and pipes
+#include <signal.h>
+#include <spawn.h>    // For launching external commands
+#include <limits.h>
+#include <sys/ioctl.h> // For the terminal width
 #include "ollama_integration.h"
+#include "ai_cache.h"
+#include "path_index.h"
+#include "frecency.h"
+#include "history.h"
+#include "editor.h"
+#include "term.h"
+#include "arena.h"
+#include "parser.h"
+#include "builtins.h"
+#include "walk.h"
+#include "dir_iter.h"
+#include "listing.h"
+#include "copy.h"
 
 // Handle macOS json-c include path
 #ifdef __APPLE__
@@ -23,8 +43,9 @@
 
 // Constants for buffer sizes and token delimiters
 #define RIPPLE_RL_BUFSIZE 1024
-#define RIPPLE_TOK_BUFSIZE 64
-#define RIPPLE_TOK_DELIM " \t\r\n\a"
+#define RIPPLE_ESC_TIMEOUT_MS 50   // wait for the rest of an escape sequence
+#define RIPPLE_MAX_REDIRECTS 16   // per builtin run in the shell process
+#define RIPPLE_FRECENCY_SEED 2000 // history lines replayed into frecency at startup
 #define RIPPLE_VERSION "1.0.0"
 #define OLLAMA_API_URL "http://localhost:11434/api/generate"
 
@@ -32,89 +53,42 @@
 #define KEY_TAB 9
 #define KEY_BACKSPACE 127
 #define KEY_ENTER 10
+// Decoded escape sequences (outside the byte range read_key returns)
+#define KEY_UP 1000
+#define KEY_DOWN 1001
+#define KEY_LEFT 1002
+#define KEY_RIGHT 1003
+#define KEY_HOME 1004
+#define KEY_END 1005
+#define KEY_DELETE 1006
+#define KEY_WORD_LEFT 1007
+#define KEY_WORD_RIGHT 1008
+#define KEY_DELETE_WORD 1009
 
 
-// Function declarations for built-in commands
-int ripple_cd(char **args);
-int ripple_help(char **args);
-int ripple_exit(char **args);
-int ripple_bg(char **args);
-int ripple_history(char **args);
-int ripple_clear(char **args);
-int ripple_echo(char **args);
-int ripple_pwd(char **args);
-int ripple_ls(char **args);
-int ripple_version(char **args);
-int ripple_calc(char **args);
-int ripple_datetime(char **args);
-int ripple_count(char **args);
-int ripple_find(char **args);
-int ripple_cat(char **args);
-int ripple_tree(char **args);
-int ripple_mkdir(char **args);
-int ripple_touch(char **args);
-int ripple_rm(char **args);
-int ripple_whoami(char **args);
-
 // Forward declarations for functions used by builtins
-char* strAppend(char* str1, char* str2);
-void add_to_hist(char **args);
-void print_tree(const char *basepath, const char *prefix, int is_last);
-
-// Array of built-in command names, used to map user input to the right functions
-char *builtin_str[] = {
-    "cd",
-    "help",
-    "exit",
-    "bg",
-    "history",
-    "clear",
-    "echo",
-    "pwd",
-    "ls",
-    "version",
-    "calc",
-    "datetime",
-    "count",
-    "find",
-    "cat",
-    "tree",
-    "mkdir",
-    "touch",
-    "rm",
-    "whoami"
-};
+static void print_tree(int parent_fd, const char *name, const char *prefix);
+static int spawn_program(pid_t *pid, char **argv, const posix_spawn_file_actions_t *actions);
+static int spawn_failed(const char *name, int err);
 
+// getdents batch buffer shared by the directory builtins
+static long long g_dirbuf[DIR_ITER_BUFSIZE / sizeof(long long)];
 
+// Background jobs started with & or bg, reaped by reap_background_jobs()
+static pid_t *g_jobs;
+static size_t g_job_count;
+static size_t g_job_cap;
 
-// Get number of built-in commands
-int ripple_num_builtins(void) {
-    return sizeof(builtin_str) / sizeof(char *);
-}
-
-// Array of built-in function pointers
-int (*builtin_func[])(char **) = {
-    &ripple_cd,
-    &ripple_help,
-    &ripple_exit,
-    &ripple_bg,
-    &ripple_history,
-    &ripple_clear,
-    &ripple_echo,
-    &ripple_pwd,
-    &ripple_ls,
-    &ripple_version,
-    &ripple_calc,
-    &ripple_datetime,
-    &ripple_count,
-    &ripple_find,
-    &ripple_cat,
-    &ripple_tree,
-    &ripple_mkdir,
-    &ripple_touch,
-    &ripple_rm,
-    &ripple_whoami
-};
+static void add_background_job(pid_t pid) {
+    if (g_job_count == g_job_cap) {
+        size_t cap = g_job_cap ? g_job_cap * 2 : 16;
+        pid_t *jobs = realloc(g_jobs, cap * sizeof(pid_t));
+        if (!jobs) return;   // left as a zombie until the shell exits
+        g_jobs = jobs;
+        g_job_cap = cap;
+    }
+    g_jobs[g_job_count++] = pid;
+}
 
 // Add these terminal control functions with better error handling and verification
 void enable_raw_mode() {
@@ -215,14 +189,14 @@ int ripple_cd(char **args) {
 // Built-in: help
 int ripple_help(char **args)
 {
-  int i;
+  size_t i;
   printf("ACM's very own shell\n");
   printf("Type program names and arguments, and hit enter.\n");
   printf("The following are built in:\n");
 
-  for (i = 0; i < ripple_num_builtins(); i++)
+  for (i = 0; i < BUILTIN_COUNT; i++)
   {
-    printf("  %s\n", builtin_str[i]);
+    printf("  %s\n", BUILTINS[i].name);
   }
 
   return 1;
@@ -274,26 +248,50 @@ int ripple_pwd(char **args) {
 
 
 // Built-in: List directory contents
+// ls [-a] [-l] [path...]: sorted, in columns on a terminal and one name
+// per line otherwise
 int ripple_ls(char **args) {
-    DIR *d;
-    struct dirent *dir;
-    char *path = "."; // Default to current directory
-    
-    if (args[1] != NULL) {
-        path = args[1];
-    }
-    
-    d = opendir(path);
-    if (d) {
-        while ((dir = readdir(d)) != NULL) {
-            // Skip hidden files (starting with .)
-            if (dir->d_name[0] != '.') {
-                printf("%s\n", dir->d_name);
+    ListOptions opt = { 0 };
+    int first_path = 0, paths = 0;
+
+    for (int i = 1; args[i] != NULL; i++) {
+        if (args[i][0] != '-' || args[i][1] == '\0') {
+            if (!first_path) first_path = i;
+            paths++;
+            continue;
+        }
+        for (const char *f = args[i] + 1; *f; f++) {
+            if (*f == 'a') {
+                opt.all = 1;
+            } else if (*f == 'l') {
+                opt.long_format = 1;
+            } else {
+                printf("Usage: ls [-a] [-l] [path...]\n");
+                return 1;
             }
         }
-        closedir(d);
-    } else {
-        perror("ripple: ls");
+    }
+
+    struct winsize ws;
+    if (isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0) {
+        opt.width = ws.ws_col;
+    }
+
+    if (paths == 0) {
+        if (list_path(".", &opt) != 0) perror("ripple: ls");
+        return 1;
+    }
+    int shown = 0;
+    for (int i = first_path; args[i] != NULL; i++) {
+        if (args[i][0] == '-' && args[i][1] != '\0') continue;
+        // Several directories are listed one after another under headings
+        struct stat st;
+        if (paths > 1 && stat(args[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+            printf("%s%s:\n", shown++ ? "\n" : "", args[i]);
+        }
+        if (list_path(args[i], &opt) != 0) {
+            fprintf(stderr, "ripple: ls: %s: %s\n", args[i], strerror(errno));
+        }
     }
     return 1;
 }
@@ -366,87 +364,144 @@ int ripple_datetime(char **args) {
     return 1;
 }
 
+// count: what each kind of entry adds to (walk counters in -r mode)
+enum {
+    COUNT_DIRS,
+    COUNT_FILES,
+    COUNT_LINKS,
+    COUNT_OTHER,
+    COUNT_BYTES,
+    COUNT_FIELDS
+};
+
+typedef struct {
+    int bytes;      // --bytes: stat regular files for their size
+} CountOptions;
+
+// Classify one entry from its d_type. A stat is only needed for --bytes,
+// or when the filesystem did not report a type.
+static void count_entry(unsigned long long counters[], int dir_fd, const char *name,
+                        unsigned char type, const CountOptions *opt) {
+    struct stat st;
+    int have_stat = 0;
+    if (type == DT_UNKNOWN || (opt->bytes && type == DT_REG)) {
+        have_stat = fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+        if (!have_stat) return;
+        type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG :
+               S_ISLNK(st.st_mode) ? DT_LNK : DT_FIFO;
+    }
+
+    switch (type) {
+    case DT_DIR: counters[COUNT_DIRS]++; break;
+    case DT_REG: counters[COUNT_FILES]++; break;
+    case DT_LNK: counters[COUNT_LINKS]++; break;
+    default:     counters[COUNT_OTHER]++; break;
+    }
+    if (have_stat && type == DT_REG) {
+        counters[COUNT_BYTES] += (unsigned long long)st.st_size;
+    }
+}
+
+static void count_visit(WalkWorker *w, const WalkEntry *e, void *user) {
+    unsigned long long local[COUNT_FIELDS] = { 0 };
+    count_entry(local, e->dir_fd, e->name, e->type, (const CountOptions *)user);
+    for (int i = 0; i < COUNT_FIELDS; i++) {
+        if (local[i]) walk_count(w, i, local[i]);
+    }
+}
+
+// Human-readable byte count: 1536 -> "1.5 KiB"
+static void format_bytes(unsigned long long n, char *out, size_t out_sz) {
+    static const char *units[] = { "bytes", "KiB", "MiB", "GiB", "TiB", "PiB" };
+    double v = (double)n;
+    int u = 0;
+    while (v >= 1024.0 && u < 5) {
+        v /= 1024.0;
+        u++;
+    }
+    if (u == 0) {
+        snprintf(out, out_sz, "%llu bytes", n);
+    } else {
+        snprintf(out, out_sz, "%.1f %s", v, units[u]);
+    }
+}
+
 // Built-in: Count files in a directory
+// count [-r] [-p] [--bytes] [path]: -r counts the whole tree, -p does so
+// with one walker thread per CPU
 int ripple_count(char **args) {
-    DIR *d;
-    struct dirent *dir;
+    CountOptions opt = { 0 };
+    int recursive = 0;
+    int threads = 1;
     char *path = "."; // Default to current directory
-    int count = 0;
-    int count_dirs = 0;
-    int count_files = 0;
-    
-    if (args[1] != NULL) {
-        path = args[1];
+
+    for (int i = 1; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-r") == 0) {
+            recursive = 1;
+        } else if (strcmp(args[i], "-p") == 0) {
+            recursive = 1;
+            threads = 0;
+        } else if (strcmp(args[i], "--bytes") == 0) {
+            opt.bytes = 1;
+        } else if (args[i][0] == '-' && args[i][1] != '\0') {
+            printf("Usage: count [-r] [-p] [--bytes] [path]\n");
+            return 1;
+        } else {
+            path = args[i];
+        }
     }
-    
-    d = opendir(path);
-    if (d) {
-        while ((dir = readdir(d)) != NULL) {
-            // Skip . and ..
-            if (strcmp(dir->d_name, ".") == 0 || strcmp(dir->d_name, "..") == 0) {
-                continue;
-            }
-            
-            count++;
-            
-            // Check if it's a directory or file
-            char fullpath[1024];
-            snprintf(fullpath, sizeof(fullpath), "%s/%s", path, dir->d_name);
-            
-            DIR *subdir = opendir(fullpath);
-            if (subdir) {
-                count_dirs++;
-                closedir(subdir);
-            } else {
-                count_files++;
-            }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    unsigned long long counters[WALK_COUNTERS] = { 0 };
+    if (recursive) {
+        if (walk_tree("count", path, threads, count_visit, &opt, counters) != 0) {
+            perror("ripple: count");
+            return 1;
         }
-        closedir(d);
-        
-        printf("Total: %d items (%d directories, %d files)\n", count, count_dirs, count_files);
     } else {
-        perror("ripple: count");
+        DirIter it;
+        DirEntry entry;
+        if (dir_iter_open(&it, AT_FDCWD, path, g_dirbuf, sizeof(g_dirbuf)) != 0) {
+            perror("ripple: count");
+            return 1;
+        }
+        while (dir_iter_next(&it, &entry) > 0) {
+            count_entry(counters, dir_iter_fd(&it), entry.name, entry.type, &opt);
+        }
+        dir_iter_close(&it);
     }
-    
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - t0.tv_sec) + (double)(t1.tv_nsec - t0.tv_nsec) / 1e9;
+    unsigned long long total = counters[COUNT_DIRS] + counters[COUNT_FILES] +
+                               counters[COUNT_LINKS] + counters[COUNT_OTHER];
+
+    printf("Total: %llu items (%llu directories, %llu files, %llu symlinks, %llu other)\n",
+           total, counters[COUNT_DIRS], counters[COUNT_FILES],
+           counters[COUNT_LINKS], counters[COUNT_OTHER]);
+    if (opt.bytes) {
+        char size[32];
+        format_bytes(counters[COUNT_BYTES], size, sizeof(size));
+        printf("Size: %s in regular files (%llu bytes)\n", size, counters[COUNT_BYTES]);
+    }
+    printf("Counted in %.3f s", secs);
+    if (secs > 0 && total > 0) {
+        printf(" (%.0f entries/s)", (double)total / secs);
+    }
+    printf("\n");
+
     return 1;
 }
 
 
-// Function to recursively find files
-void find_files(const char *base_path, const char *pattern, int *count) {
-    DIR *d;
-    struct dirent *dir;
-    
-    d = opendir(base_path);
-    if (!d) {
-        return;
-    }
-    
-    while ((dir = readdir(d)) != NULL) {
-        // Skip . and ..
-        if (strcmp(dir->d_name, ".") == 0 || strcmp(dir->d_name, "..") == 0) {
-            continue;
-        }
-        
-        // Create path
-        char path[1024];
-        snprintf(path, sizeof(path), "%s/%s", base_path, dir->d_name);
-        
-        // Check if matches pattern
-        if (fnmatch(pattern, dir->d_name, 0) == 0) {
-            printf("%s\n", path);
-            (*count)++;
-        }
-        
-        // Recurse if it's a directory
-        DIR *subdir = opendir(path);
-        if (subdir) {
-            closedir(subdir);
-            find_files(path, pattern, count);
-        }
+// find: print every entry whose name matches the pattern
+static void find_visit(WalkWorker *w, const WalkEntry *e, void *user) {
+    if (fnmatch((const char *)user, e->name, 0) == 0) {
+        walk_emit_path(w, e);
+        walk_count(w, 0, 1);
     }
-    
-    closedir(d);
 }
 
 // Built-in: Find files matching pattern
@@ -465,83 +520,121 @@ int ripple_find(char **args) {
     
     printf("Searching for files matching '%s'...\n", args[1]);
     
-    int count = 0;
-    find_files(cwd, args[1], &count);
+    unsigned long long found[WALK_COUNTERS];
+    if (walk_tree("find", cwd, 0, find_visit, args[1], found) != 0) {
+        perror("ripple: find");
+        return 1;
+    }
     
-    printf("Found %d matching items\n", count);
+    printf("Found %llu matching items\n", found[0]);
     
     return 1;
 }
 
 // Built-in: Cat (display file contents)
+// cat [-n] [file...]: "-" or no file reads standard input
 int ripple_cat(char **args) {
-    if (args[1] == NULL) {
-        printf("Usage: cat <filename>\n");
-        return 1;
+    int number = 0;
+    int files = 0;
+    for (int i = 1; args[i] != NULL; i++) {
+        if (strcmp(args[i], "-n") == 0) {
+            number = 1;
+        } else if (args[i][0] == '-' && args[i][1] != '\0') {
+            printf("Usage: cat [-n] [file...]\n");
+            return 1;
+        } else {
+            files++;
+        }
     }
-    
-    FILE *file = fopen(args[1], "r");
-    if (!file) {
-        perror("ripple: cat");
+    // Reading the terminal would leave the shell waiting for ^D
+    if (files == 0 && isatty(STDIN_FILENO)) {
+        printf("Usage: cat [-n] [file...]\n");
         return 1;
     }
-    
-    char buffer[1024];
-    while (fgets(buffer, sizeof(buffer), file)) {
-        printf("%s", buffer);
+
+    // The copy writes to the descriptor; stdio output must come first
+    fflush(stdout);
+    CopyLines lines = { 0, 1 };
+    for (int i = 1; args[i] != NULL || files == 0; i++) {
+        const char *name = files == 0 ? "-" : args[i];
+        if (files > 0 && strcmp(name, "-n") == 0) continue;
+
+        int fd = strcmp(name, "-") == 0 ? STDIN_FILENO : open(name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            fprintf(stderr, "ripple: cat: %s: %s\n", name, strerror(errno));
+            continue;
+        }
+        int result = number ? copy_fd_numbered(fd, STDOUT_FILENO, &lines) : copy_fd(fd, STDOUT_FILENO);
+        int err = errno;
+        if (fd != STDIN_FILENO) close(fd);
+        if (result != 0) {
+            // The reader went away: nothing more to do for any file
+            if (err == EPIPE) break;
+            fprintf(stderr, "ripple: cat: %s: %s\n", name, strerror(err));
+        }
+        if (files == 0) break;
     }
-    
-    fclose(file);
     return 1;
 }
 
-// Helper function to print directory tree
-void print_tree(const char *basepath, const char *prefix, int is_last) {
-    DIR *dir = opendir(basepath);
-    if (!dir) {
+// Entry of a directory kept while the ones before it are printed
+typedef struct {
+    const char *name;
+    int is_dir;
+} TreeEntry;
+
+// Print the contents of parent_fd/name below prefix, recursing into
+// subdirectories. Each directory is read once: its entries are collected
+// first so the last one (drawn with └──) is known before printing.
+static void print_tree(int parent_fd, const char *name, const char *prefix) {
+    DirIter it;
+    if (dir_iter_open(&it, parent_fd, name, g_dirbuf, sizeof(g_dirbuf)) != 0) {
         return;
     }
-    
-    // Print current directory
-    printf("%s%s%s\n", prefix, is_last ? "└── " : "├── ", strrchr(basepath, '/') ? strrchr(basepath, '/') + 1 : basepath);
-    
-    // Create new prefix for children
-    char new_prefix[1024];
-    sprintf(new_prefix, "%s%s", prefix, is_last ? "    " : "│   ");
-    
-    // Count entries to determine which is the last one
-    struct dirent *entry;
-    int count = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] != '.' && strcmp(entry->d_name, "..") != 0) {
-            count++;
+
+    Arena names;
+    arena_init(&names, 0);
+    TreeEntry *items = NULL;
+    size_t count = 0, cap = 0;
+    DirEntry entry;
+    while (dir_iter_next(&it, &entry) > 0) {
+        if (entry.name[0] == '.') {
+            continue;
+        }
+        if (count == cap) {
+            size_t new_cap = cap ? cap * 2 : 32;
+            TreeEntry *temp = realloc(items, new_cap * sizeof(TreeEntry));
+            if (!temp) break;
+            items = temp;
+            cap = new_cap;
+        }
+        int is_dir = entry.type == DT_DIR;
+        if (entry.type == DT_UNKNOWN) {
+            struct stat st;
+            is_dir = fstatat(dir_iter_fd(&it), entry.name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
         }
+        items[count].name = arena_strndup(&names, entry.name, entry.name_len);
+        items[count].is_dir = is_dir;
+        if (items[count].name) count++;
     }
-    
-    // Reset directory stream
-    rewinddir(dir);
-    
-    // Process entries
-    int i = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] != '.' && strcmp(entry->d_name, "..") != 0) {
-            i++;
-            
-            char path[1024];
-            snprintf(path, sizeof(path), "%s/%s", basepath, entry->d_name);
-            
-            // Check if it's a directory
-            DIR *subdir = opendir(path);
-            if (subdir) {
-                closedir(subdir);
-                print_tree(path, new_prefix, i == count);
-            } else {
-                printf("%s%s%s\n", new_prefix, i == count ? "└── " : "├── ", entry->d_name);
-            }
+    // The descriptor outlives the listing: subdirectories are opened from it
+    int fd = dir_iter_take_fd(&it);
+    dir_iter_close(&it);
+
+    size_t prefix_len = strlen(prefix);
+    char *child_prefix = arena_alloc(&names, prefix_len + sizeof("│   "));
+    for (size_t i = 0; i < count; i++) {
+        int is_last = i == count - 1;
+        printf("%s%s%s\n", prefix, is_last ? "└── " : "├── ", items[i].name);
+        if (items[i].is_dir && child_prefix) {
+            snprintf(child_prefix, prefix_len + sizeof("│   "), "%s%s", prefix, is_last ? "    " : "│   ");
+            print_tree(fd, items[i].name, child_prefix);
         }
     }
-    
-    closedir(dir);
+
+    close(fd);
+    free(items);
+    arena_free(&names);
 }
 
 // Built-in: Tree (display directory structure)
@@ -551,49 +644,15 @@ int ripple_tree(char **args) {
         path = args[1];
     }
     
-    DIR *dir = opendir(path);
-    if (!dir) {
+    int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
         perror("ripple: tree");
         return 1;
     }
-    closedir(dir);
     
     printf("%s\n", path);
-    
-    // Count entries to determine which is the last one
-    dir = opendir(path);
-    struct dirent *entry;
-    int count = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] != '.' && strcmp(entry->d_name, "..") != 0) {
-            count++;
-        }
-    }
-    
-    // Reset directory stream
-    rewinddir(dir);
-    
-    // Process entries
-    int i = 0;
-    while ((entry = readdir(dir)) != NULL) {
-        if (entry->d_name[0] != '.' && strcmp(entry->d_name, "..") != 0) {
-            i++;
-            
-            char full_path[1024];
-            snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-            
-            // Check if it's a directory
-            DIR *subdir = opendir(full_path);
-            if (subdir) {
-                closedir(subdir);
-                print_tree(full_path, "", i == count);
-            } else {
-                printf("%s%s\n", i == count ? "└── " : "├── ", entry->d_name);
-            }
-        }
-    }
-    
-    closedir(dir);
+    print_tree(fd, ".", "");
+    close(fd);
     return 1;
 }
 
@@ -659,345 +718,980 @@ int ripple_whoami(char **args) {
     return 1;
 }
 
-struct Node {
-    char *str;
-    struct Node* next;
-};
-struct Node* head = NULL;
-struct Node* cur = NULL;
+// Built-in: Show AI completion cache counters
+int ripple_aistats(char **args) {
+    CompletionCacheStats st;
+    completion_cache_stats(&st);
+    unsigned long lookups = st.hits + st.misses;
+    printf("AI completion cache: %d entries\n", st.entries);
+    printf("  hits:   %lu\n", st.hits);
+    printf("  misses: %lu\n", st.misses);
+    if (lookups > 0) {
+        printf("  hit rate: %.1f%%\n", 100.0 * (double)st.hits / (double)lookups);
+    }
+    printf("  model time saved: %.1f s\n", st.saved_ms / 1000.0);
+    return 1;
+}
 
-char* strAppend(char* str1, char* str2)
-{
-	char* str3 = (char*)malloc(sizeof(char)*(strlen(str1)+strlen(str2)+1));
-  if (!str3) return NULL;
-  strcpy(str3, str1);
-  strcat(str3, str2);
-	return str3;
-}
-void add_to_hist(char **args){
-  if(head==NULL){
-    head = (struct Node *)malloc(sizeof(struct Node));
-    head->str = (char *)malloc(0x1000);
-    if (!head->str) return;
-    char *str1 = " ";
-    char *temp;
-    if (args[1] == NULL) {
-        temp = strAppend(args[0], str1);
-        if (temp) {
-            strcpy(head->str, temp);
-            free(temp);
-        }
-    } else {
-        temp = strAppend(args[0], str1);
-        if (temp) {
-            strcpy(head->str, temp);
-            free(temp);
-        }
-        temp = strAppend(head->str, args[1]);
-        if (temp) {
-            strcpy(head->str, temp);
-            free(temp);
-        }
-    }
-    head->next = NULL;
-    cur = head;
-  } else {
-    struct Node *ptr = (struct Node *)malloc(sizeof(struct Node));
-    cur->next = ptr;
-    ptr->str = (char *)malloc(0x1000);
-    if (!ptr->str) return;
-    char *str1 = " ";
-    char *temp;
-    if (args[1] == NULL) {
-        temp = strAppend(args[0], str1);
-        if (temp) {
-            strcpy(ptr->str, temp);
-            free(temp);
-        }
-    } else {
-        temp = strAppend(args[0], str1);
-        if (temp) {
-            strcpy(ptr->str, temp);
-            free(temp);
-        }
-        temp = strAppend(ptr->str, args[1]);
-        if (temp) {
-            strcpy(ptr->str, temp);
-            free(temp);
-        }
+// Walk the history from oldest to newest (used by fuzzy completion)
+void ripple_history_foreach(ripple_history_fn fn, void *user) {
+    size_t n = history_count();
+    for (size_t i = 0; i < n; i++) {
+        fn(history_get(i), user);
     }
-    ptr->next = NULL;
-    cur = ptr;
-  }
 }
 
 //creating a function to display history:
-int ripple_history(char **args){  
-   struct Node* ptr = head;
-    int i = 1;
-    while (ptr != NULL)
-    {
-    printf(" %d %s\n",i++,ptr->str);
-    ptr = ptr->next;
+int ripple_history(char **args){
+    size_t n = history_count();
+    for (size_t i = 0; i < n; i++) {
+        printf(" %zu %s\n", i + 1, history_get(i));
     }
-  return 1; 
-  }
+    return 1;
+}
 
 // Background command execution
 int ripple_bg(char **args)
 {
   ++args;
-  char *firstCmd = args[0]; // echo
-  int childpid = fork();
-  if (childpid >= 0)
+  if (args[0] == NULL)
   {
-    if (childpid == 0)
-    {
-      if (execvp(firstCmd, args) < 0)
-      {
-        perror("Error on execvp\n");
-        exit(0);
-      }
-    }
+    fprintf(stderr, "ripple: bg: expected a command\n");
+    return 1;
+  }
+  // Not waited for here; ripple_loop reaps it once it exits
+  pid_t pid;
+  int err = spawn_program(&pid, args, NULL);
+  if (err != 0)
+  {
+    spawn_failed(args[0], err);
   }
   else
   {
-    perror("fork() error");
+    add_background_job(pid);
   }
   return 1;
 }
 
-// Launch an external command in the foreground
-int ripple_launch(char **args) {
-    pid_t pid;
-    int status;
+// Close-on-exec pipe, so stages only keep the ends dup2'd onto 0 and 1
+static int make_pipe(int fds[2]) {
+#ifdef __APPLE__
+    if (pipe(fds) < 0) return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return 0;
+#else
+    return pipe2(fds, O_CLOEXEC);
+#endif
+}
 
-    pid = fork();
-    if (pid == 0) {
-        // Child process
-        if (execvp(args[0], args) == -1) {
-            if (errno == ENOENT) {
-                fprintf(stderr, "ripple: command not found: %s\n", args[0]);
-            } else {
-                perror("ripple");
+// Open the file of a REDIR_IN/OUT/APPEND redirection, close-on-exec.
+// Returns -1 after reporting the error.
+static int open_redirect(const Redirect *r) {
+    int fd;
+    switch (r->kind) {
+    case REDIR_IN:
+        fd = open(r->path, O_RDONLY | O_CLOEXEC);
+        break;
+    case REDIR_OUT:
+        fd = open(r->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        break;
+    default:
+        fd = open(r->path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+        break;
+    }
+    if (fd < 0) {
+        fprintf(stderr, "ripple: %s: %s\n", r->path, strerror(errno));
+    }
+    return fd;
+}
+
+// Apply a command's redirections to the current process, in source order
+static int apply_redirects(const Redirect *r) {
+    for (; r; r = r->next) {
+        if (r->kind == REDIR_DUP) {
+            if (dup2(r->dup_fd, r->fd) < 0) {
+                fprintf(stderr, "ripple: %d: %s\n", r->dup_fd, strerror(errno));
+                return -1;
             }
-            exit(EXIT_FAILURE);
+            continue;
+        }
+        int fd = open_redirect(r);
+        if (fd < 0) {
+            return -1;
         }
-    } else if (pid < 0) {
-        // Fork error
-        perror("ripple");
+        if (fd != r->fd) {
+            dup2(fd, r->fd);
+            close(fd);
+        } else {
+            // Opened straight onto the target: it must survive exec
+            fcntl(fd, F_SETFD, 0);
+        }
+    }
+    return 0;
+}
+
+// Exit status in the shell's sense: the exit code, or 128 + signal
+static int wait_for(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) return 1;
+    }
+    if (WIFEXITED(status)) return WEXITSTATUS(status);
+    if (WIFSIGNALED(status)) return 128 + WTERMSIG(status);
+    return 1;
+}
+
+// Start an external program. posix_spawn creates the child vfork-style
+// instead of copying the shell's page tables, so launch time does not grow
+// with the shell's memory. The binary comes from the PATH index; names it
+// does not know fall back to posix_spawnp's own $PATH walk.
+// Returns 0 or an errno value.
+static int spawn_program(pid_t *pid, char **argv, const posix_spawn_file_actions_t *actions) {
+    posix_spawnattr_t attr;
+    sigset_t defaults;
+    char path[PATH_MAX];
+    int err;
+
+    // The shell ignores SIGPIPE and an ignored signal stays ignored across
+    // exec; programs get the default back so writers into a closed pipe die
+    posix_spawnattr_init(&attr);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+
+    if (!strchr(argv[0], '/') && path_index_lookup(argv[0], path, sizeof(path))) {
+        err = posix_spawn(pid, path, actions, &attr, argv, environ);
     } else {
-        // Parent process
-        waitpid(pid, &status, 0); // Simplified, no WUNTRACED
+        err = posix_spawnp(pid, argv[0], actions, &attr, argv, environ);
     }
-    return 1; // Continue shell loop
+    posix_spawnattr_destroy(&attr);
+    return err;
 }
 
-// Execute a command (built-in or external)
-int ripple_execute(char **args) {
-    if (args[0] == NULL) {
-        // Empty command
-        return 1;
+// Exit status for a program that could not be started, after reporting it
+static int spawn_failed(const char *name, int err) {
+    if (err == ENOENT) {
+        fprintf(stderr, "ripple: command not found: %s\n", name);
+        return 127;
+    }
+    fprintf(stderr, "ripple: %s: %s\n", name, strerror(err));
+    return 126;
+}
+
+// Spawn an external pipeline stage reading in_fd and writing out_fd (-1
+// leaves the shell's own). Redirection files are opened here rather than by
+// spawn file actions so that errors name the file. Returns the pid, or -1
+// with the stage's exit status in *status.
+static pid_t spawn_stage(const SimpleCommand *cmd, int in_fd, int out_fd, int *status) {
+    posix_spawn_file_actions_t actions;
+    int opened[RIPPLE_MAX_REDIRECTS];
+    int nopened = 0;
+    pid_t pid = -1;
+
+    *status = 1;
+    posix_spawn_file_actions_init(&actions);
+    if (in_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    }
+    if (out_fd >= 0) {
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    }
+    for (const Redirect *r = cmd->redirects; r; r = r->next) {
+        if (r->kind == REDIR_DUP) {
+            posix_spawn_file_actions_adddup2(&actions, r->dup_fd, r->fd);
+            continue;
+        }
+        if (nopened == RIPPLE_MAX_REDIRECTS) {
+            fprintf(stderr, "ripple: %s: too many redirections\n", cmd->argv[0]);
+            goto done;
+        }
+        int fd = open_redirect(r);
+        if (fd < 0) {
+            goto done;
+        }
+        opened[nopened++] = fd;
+        posix_spawn_file_actions_adddup2(&actions, fd, r->fd);
+    }
+
+    int err = spawn_program(&pid, cmd->argv, &actions);
+    if (err != 0) {
+        pid = -1;
+        *status = spawn_failed(cmd->argv[0], err);
+    }
+
+done:
+    while (nopened-- > 0) {
+        close(opened[nopened]);
     }
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+// Child side of a stage that has to run in a copy of the shell: a builtin,
+// or a command made of redirections only
+static void run_stage(const SimpleCommand *cmd) {
+    signal(SIGPIPE, SIG_DFL);
+    if (apply_redirects(cmd->redirects) < 0) _exit(1);
+    if (cmd->argv[0] == NULL) _exit(0);
+
+    builtin_find(cmd->argv[0])->run(cmd->argv);
+    term_flush();
+    fflush(stdout);
+    _exit(0);
+}
+
+// Launch a pipeline in the foreground: one child per stage, each stage's
+// stdout wired straight into the next stage's stdin. External programs are
+// spawned; only builtins inside a pipeline need a fork. Returns the exit
+// status of the last stage.
+int ripple_launch(const Pipeline *pl) {
+    pid_t pids[pl->count];
+    int started = 0;
+    int in_fd = -1;
+    int status = 0;
+
+    // Anything still buffered would otherwise be written by every child too
+    term_flush();
+    fflush(stdout);
+
+    for (int i = 0; i < pl->count; i++) {
+        const SimpleCommand *cmd = &pl->commands[i];
+        int fds[2] = { -1, -1 };
+        if (i < pl->count - 1 && make_pipe(fds) < 0) {
+            perror("ripple: pipe");
+            status = 1;
+            break;
+        }
+
+        pid_t pid;
+        int stage_status = 0;
+        if (cmd->argv[0] && !builtin_find(cmd->argv[0])) {
+            pid = spawn_stage(cmd, in_fd, fds[1], &stage_status);
+        } else {
+            pid = fork();
+            if (pid == 0) {
+                if (in_fd >= 0) {
+                    dup2(in_fd, STDIN_FILENO);
+                }
+                if (fds[1] >= 0) {
+                    dup2(fds[1], STDOUT_FILENO);
+                }
+                // Nothing gets exec'd to close these: a read end left open
+                // here would keep a writing builtin from ever seeing EPIPE
+                if (in_fd >= 0) close(in_fd);
+                if (fds[0] >= 0) close(fds[0]);
+                if (fds[1] >= 0) close(fds[1]);
+                run_stage(cmd);
+            } else if (pid < 0) {
+                perror("ripple: fork");
+                stage_status = 1;
+            }
+        }
+
+        if (in_fd >= 0) close(in_fd);
+        if (fds[1] >= 0) close(fds[1]);
+        in_fd = fds[0];
+        if (pid > 0) {
+            pids[started++] = pid;
+        }
+        // A stage that did not start still gets EOF/EPIPE from its neighbours
+        if (i == pl->count - 1) {
+            status = pid > 0 ? -1 : stage_status;
+        }
+        if (cmd->argv[0]) {
+            frecency_record(cmd->argv[0]);
+        }
+    }
+    if (in_fd >= 0) close(in_fd);
+
+    for (int i = 0; i < started; i++) {
+        int s = wait_for(pids[i]);
+        if (status == -1 && i == started - 1) status = s;
+    }
+    return status;
+}
+
+// Run a builtin in the shell process itself (so cd and exit work), with its
+// redirections applied around it and undone afterwards
+static int run_builtin(const Builtin *b, const SimpleCommand *cmd, int *status) {
+    int saved_fd[RIPPLE_MAX_REDIRECTS];
+    int target_fd[RIPPLE_MAX_REDIRECTS];
+    int saved = 0;
+    int keep_running = 1;
+
+    term_flush();
+    fflush(stdout);
+    for (const Redirect *r = cmd->redirects; r; r = r->next) {
+        if (saved == RIPPLE_MAX_REDIRECTS) {
+            fprintf(stderr, "ripple: %s: too many redirections\n", cmd->argv[0]);
+            *status = 1;
+            while (saved-- > 0) {
+                if (saved_fd[saved] >= 0) close(saved_fd[saved]);
+            }
+            return 1;
+        }
+        target_fd[saved] = r->fd;
+        saved_fd[saved++] = fcntl(r->fd, F_DUPFD_CLOEXEC, 10);
+    }
+
+    *status = 1;
+    if (apply_redirects(cmd->redirects) == 0) {
+        frecency_record(cmd->argv[0]);
+        keep_running = b->run(cmd->argv);
+        *status = 0;
+    }
+
+    term_flush();
+    fflush(stdout);
+    while (saved-- > 0) {
+        if (saved_fd[saved] >= 0) {
+            dup2(saved_fd[saved], target_fd[saved]);
+            close(saved_fd[saved]);
+        } else {
+            close(target_fd[saved]);
+        }
+    }
+    return keep_running;
+}
+
+// Execute one pipeline. Returns 0 when the shell should exit; the pipeline's
+// exit status goes to *status (builtins always count as success).
+int ripple_execute(const Pipeline *pl, int *status) {
+    const SimpleCommand *cmd = &pl->commands[0];
+
+    if (pl->count == 1 && cmd->argv[0]) {
+        const Builtin *b = builtin_find(cmd->argv[0]);
+        if (b) {
+            return run_builtin(b, cmd, status);
+        }
+    }
+
+    *status = ripple_launch(pl);
+    return 1;
+}
+
+// Run a && / || chain, skipping pipelines whose condition does not hold
+static int ripple_run_and_or(const AndOr *ao, int *status) {
+    *status = 0;
+    for (int i = 0; i < ao->count; i++) {
+        if ((ao->ops[i] == AND_OR_AND && *status != 0) ||
+            (ao->ops[i] == AND_OR_OR && *status == 0)) {
+            continue;
+        }
+        if (!ripple_execute(&ao->pipelines[i], status)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Run a parsed command line. Returns 0 when the shell should exit.
+// A chain ending in '&' runs in a child of its own that is not waited for.
+int ripple_run_list(const CommandList *list) {
+    int status;
+    for (int i = 0; i < list->count; i++) {
+        const AndOr *ao = &list->items[i];
+        if (!ao->background) {
+            if (!ripple_run_and_or(ao, &status)) {
+                return 0;
+            }
+            continue;
+        }
 
-    // Check for built-in commands
-    for (int i = 0; i < ripple_num_builtins(); i++) {
-        if (strcmp(args[0], builtin_str[i]) == 0) {
-            add_to_hist(args); // Add command to history before executing
-            return (*builtin_func[i])(args);
+        term_flush();
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            ripple_run_and_or(ao, &status);
+            term_flush();
+            fflush(stdout);
+            _exit(status);
+        } else if (pid < 0) {
+            perror("ripple: fork");
+        } else {
+            add_background_job(pid);
+            term_printf("[%d]\n", (int)pid);
         }
     }
+    return 1;
+}
+
+// Collect background jobs that have finished so they do not linger as zombies.
+// Only the shell's own jobs are waited for: waitpid(-1) would also take the
+// popen() child of an AI lookup out from under the worker's pclose().
+static void reap_background_jobs(void) {
+    for (size_t i = 0; i < g_job_count; ) {
+        pid_t r = waitpid(g_jobs[i], NULL, WNOHANG);
+        if (r > 0 || (r < 0 && errno == ECHILD)) {
+            g_jobs[i] = g_jobs[--g_job_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+// Number of lines the last drawn prompt occupies (1 when getcwd fails)
+static int prompt_lines = 2;
+// Working directory shown in the prompt, refreshed once per command
+static char prompt_cwd[1024];
+
+// Line being edited and what the terminal currently shows of it
+static GapBuffer g_line;
+static Screen g_screen;
+// Rest of the inline suggestion for g_line ("" = none)
+static char g_ghost[RIPPLE_RL_BUFSIZE];
+
+// Draw the input line of the prompt (the arrow and what has been typed)
+static void print_prompt_input(const char *buffer) {
+    if (!buffer) buffer = "";
+    term_puts(TERM_PINK "└─▶" TERM_RESET " " TERM_GREEN);
+    term_puts(buffer);
+    screen_reset(&g_screen, buffer, strlen(buffer));
+}
+
+// Redraw the two-line prompt with the cached working directory
+static void redraw_prompt(const char *buffer) {
+    if (prompt_lines == 2) {
+        term_puts(TERM_PINK "┌─[" TERM_CYAN);
+        term_puts(prompt_cwd);
+        term_puts(TERM_PINK "]" TERM_RESET "\n");
+    }
+    print_prompt_input(buffer);
+}
+
+// Draw the two-line prompt followed by the current input buffer
+static void print_prompt(const char *buffer) {
+    prompt_lines = getcwd(prompt_cwd, sizeof(prompt_cwd)) != NULL ? 2 : 1;
+    redraw_prompt(buffer);
+}
+
+// Print text that arrived in the background (AI output) above the prompt,
+// then redraw the prompt with what the user has typed so far
+static void print_above_prompt(const char *text, const char *buffer) {
+    term_puts(TERM_CLEAR_LINE);
+    if (prompt_lines == 2) {
+        term_puts("\033[1A\033[K");
+    }
+    term_puts(TERM_RESET);
+    term_puts(text);
+    redraw_prompt(buffer);
+}
+
+// Suggest the rest of the line after an edit. Only offered with the cursor
+// at the end; autosuggest_line keeps its candidates between keystrokes.
+static void update_ghost(void) {
+    g_ghost[0] = '\0';
+    if (g_line.gap_start != gap_length(&g_line)) return;
+    const char *line = gap_text(&g_line);
+    const char *suggestion = autosuggest_line(line);
+    if (suggestion) {
+        snprintf(g_ghost, sizeof(g_ghost), "%s", suggestion + strlen(line));
+    }
+}
 
-    // External command
-    add_to_hist(args); // Add command to history before executing
-    return ripple_launch(args);
+static const char *visible_ghost(void) {
+    if (!g_ghost[0] || g_line.gap_start != gap_length(&g_line)) return NULL;
+    return g_ghost;
+}
+
+// Take the rest of the line out of the ghost text before leaving the line
+static void clear_ghost(void) {
+    g_ghost[0] = '\0';
+    screen_render(&g_screen, &g_line, NULL);
+}
+
+// Wait for the next input byte. While waiting, AI answers from the
+// background worker are rendered as soon as they arrive.
+static int read_key(void) {
+    while (1) {
+        struct pollfd fds[2];
+        int nfds = 1;
+        fds[0].fd = STDIN_FILENO;
+        fds[0].events = POLLIN;
+        int ai_fd = ai_async_fd();
+        if (ai_fd >= 0) {
+            fds[1].fd = ai_fd;
+            fds[1].events = POLLIN;
+            nfds = 2;
+        }
+
+        term_flush();   // end of frame: everything drawn so far goes out now
+        if (poll(fds, nfds, -1) < 0) {
+            if (errno == EINTR) continue;
+            return EOF;
+        }
+        if (nfds == 2 && (fds[1].revents & POLLIN)) {
+            char *text = ai_async_take();
+            if (text) {
+                char *line = gap_strdup(&g_line);
+                print_above_prompt(text, line ? line : "");
+                free(line);
+                free(text);
+                screen_render(&g_screen, &g_line, visible_ghost());   // put the cursor back
+            }
+        }
+        if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+            unsigned char ch;
+            ssize_t n = read(STDIN_FILENO, &ch, 1);
+            if (n == 1) return ch;
+            if (n < 0 && errno == EINTR) continue;
+            return EOF;
+        }
+    }
+}
+
+// Next byte of an escape sequence, or -1 if none follows quickly (a lone Esc)
+static int read_escape_byte(void) {
+    struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+    if (poll(&pfd, 1, RIPPLE_ESC_TIMEOUT_MS) <= 0) return -1;
+    unsigned char ch;
+    return read(STDIN_FILENO, &ch, 1) == 1 ? ch : -1;
+}
+
+// Decode the rest of an escape sequence after ESC into a KEY_* code.
+// Unknown sequences are swallowed (0); a lone Esc is returned as 27.
+static int read_escape(void) {
+    int c = read_escape_byte();
+    if (c < 0) return 27;
+    if (c == 'b' || c == 'B') return KEY_WORD_LEFT;     // Alt-b
+    if (c == 'f' || c == 'F') return KEY_WORD_RIGHT;    // Alt-f
+    if (c == 'd' || c == 'D') return KEY_DELETE_WORD;   // Alt-d
+    if (c != '[' && c != 'O') return 0;
+
+    // CSI/SS3: parameters then a final byte in 0x40..0x7e
+    char params[16];
+    size_t n = 0;
+    int final;
+    while ((final = read_escape_byte()) >= 0 && (final < 0x40 || final > 0x7e)) {
+        if (n < sizeof(params) - 1) params[n++] = (char)final;
+    }
+    params[n] = '\0';
+    if (final < 0) return 0;
+
+    // ";5" (Ctrl) or ";3" (Alt) turns left/right into word motions
+    int word = strstr(params, ";5") != NULL || strstr(params, ";3") != NULL;
+    switch (final) {
+        case 'A': return KEY_UP;
+        case 'B': return KEY_DOWN;
+        case 'C': return word ? KEY_WORD_RIGHT : KEY_RIGHT;
+        case 'D': return word ? KEY_WORD_LEFT : KEY_LEFT;
+        case 'H': return KEY_HOME;
+        case 'F': return KEY_END;
+        case '~':
+            if (strcmp(params, "1") == 0 || strcmp(params, "7") == 0) return KEY_HOME;
+            if (strcmp(params, "4") == 0 || strcmp(params, "8") == 0) return KEY_END;
+            if (strcmp(params, "3") == 0) return KEY_DELETE;
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Draw the reverse-i-search line in place of the prompt's input line
+static void print_search_line(const char *query, const char *match, int failed) {
+    term_puts(failed ? TERM_CLEAR_LINE TERM_PINK "(failed reverse-i-search)" TERM_RESET "`"
+                     : TERM_CLEAR_LINE TERM_PINK "(reverse-i-search)" TERM_RESET "`");
+    term_puts(query);
+    term_puts("': " TERM_GREEN);
+    term_puts(match ? match : "");
+}
+
+// Incremental reverse history search (Ctrl-R). Typing narrows the query,
+// Ctrl-R again jumps to the next older match, Enter runs the match and
+// Ctrl-G/Esc restores the original line; any other key keeps the match for
+// editing. Returns 1 when the caller should execute the line right away.
+static int reverse_search(void) {
+    char query[256] = "";
+    size_t qlen = 0;
+    long match = -1;
+    int failed = 0;
+    int run = 0;
+
+    ai_async_cancel();
+    print_search_line(query, NULL, 0);
+    while (1) {
+        int c = read_key();
+        if (c == 27) c = read_escape();
+        if (c == EOF || c == 7 || c == 27) {             // Ctrl-G / Esc: give up
+            break;
+        }
+        if (c == 18) {                                   // Ctrl-R: older match
+            long next = history_search(query, match >= 0 ? (size_t)match : history_count());
+            if (next >= 0) match = next;
+            failed = next < 0;
+        } else if (c == 127 || c == '\b') {
+            if (qlen > 0) query[--qlen] = '\0';
+            match = history_search(query, history_count());
+            failed = qlen > 0 && match < 0;
+        } else if (c >= 32 && c < 127) {
+            if (qlen < sizeof(query) - 1) {
+                query[qlen++] = (char)c;
+                query[qlen] = '\0';
+            }
+            // The current match may still contain the longer query
+            long next = history_search(query, match >= 0 ? (size_t)match + 1 : history_count());
+            if (next >= 0) match = next;
+            failed = next < 0;
+        } else {
+            // Enter runs the match; anything else keeps it for editing
+            if (match >= 0) gap_set(&g_line, history_get((size_t)match));
+            run = (c == '\n' || c == '\r') && match >= 0;
+            break;
+        }
+        print_search_line(query, match >= 0 ? history_get((size_t)match) : NULL, failed);
+    }
+
+    term_puts(TERM_CLEAR_LINE);
+    char *line = gap_strdup(&g_line);
+    print_prompt_input(line ? line : "");
+    free(line);
+    g_ghost[0] = '\0';
+    screen_render(&g_screen, &g_line, NULL);
+    return run;
 }
 
 // Modify the main shell loop to use raw mode
 void ripple_loop(void) {
     char *line;
-    char **args;
-    int status;
-    char cwd[1024];
+    Arena arena;
+    CommandList *list;
+    const char *error;
+    int status = 1;
+
+    arena_init(&arena, 0);
 
     // Enable raw mode at the start
     enable_raw_mode();
 
     do {
-        if (getcwd(cwd, sizeof(cwd)) != NULL) {
-            printf("\033[1;95m┌─[\033[1;96m%s\033[1;95m]\033[0m\n", cwd);
-            printf("\033[1;95m└─▶\033[0m \033[1;92m");
-            fflush(stdout);  // Ensure prompt is displayed immediately
-        } else {
-            printf("\033[1;95m└─▶\033[0m \033[1;92m");
-            fflush(stdout);
-        }
-        
+        history_sync();
+        print_prompt("");
+
         line = ripple_read_line();
         if (!line) {
             break;
         }
-        args = ripple_split_line(line);
-        if (!args) {
-            free(line);
+        // Keep the line as typed; the parser unquotes it in place.
+        // The arena is reset rather than freed so that steady-state parsing
+        // reuses the same blocks.
+        history_add(line);
+        arena_reset(&arena);
+        list = parse_command_line(&arena, line, &error);
+        if (!list) {
+            term_printf("ripple: %s\n", error);
             continue;
         }
-        status = ripple_execute(args);
-        
-        // Print newline after command execution for better visibility
-        printf("\n");
+        status = ripple_run_list(list);
+        reap_background_jobs();
 
-        free(line);
-        free(args);
+        // Print newline after command execution for better visibility
+        term_puts("\n");
     } while (status);
 
+    arena_free(&arena);
+
     // Disable raw mode before exiting
     disable_raw_mode();
 }
 
-// Read a line of input
-char *ripple_read_line(void) {
-    int bufsize = RIPPLE_RL_BUFSIZE;
-    int position = 0;
-    char *buffer = malloc(sizeof(char) * bufsize);
-    int c;
-    if (!buffer) {
-        fprintf(stderr, "ripple: allocation error\n");
-        exit(EXIT_FAILURE);
+// TAB: show suggestions below the prompt and complete the line in place
+static void complete_line(void) {
+    clear_ghost();
+    char *buffer = gap_strdup(&g_line);
+    if (!buffer) return;
+
+    // If buffer contains spaces, suggest args for the first token (e.g., gcc flags).
+    // Otherwise, suggest/complete the command name.
+    char *last_space = strrchr(buffer, ' ');
+    if (last_space != NULL) {
+        // First token = command (up to first space)
+        char cmd[128];
+        size_t cmd_len = 0;
+        while (buffer[cmd_len] && buffer[cmd_len] != ' ' && buffer[cmd_len] != '\t' && cmd_len < sizeof(cmd) - 1) {
+            cmd[cmd_len] = buffer[cmd_len];
+            cmd_len++;
+        }
+        cmd[cmd_len] = '\0';
+
+        // Current arg token = after last space (may be empty if trailing space)
+        const char *arg_partial = last_space + 1;
+
+        term_puts("\n");
+        suggest_external_args(cmd, arg_partial);
+
+        // Try to autocomplete current arg token if it uniquely matches a known flag
+        char completed_arg[128];
+        int argc = complete_external_arg(cmd, arg_partial, completed_arg, sizeof(completed_arg));
+        if (argc == 1 && completed_arg[0] != '\0') {
+            gap_move(&g_line, (size_t)(arg_partial - buffer));
+            gap_delete_after(&g_line, strlen(arg_partial));
+            gap_insert(&g_line, completed_arg, strlen(completed_arg));
+        }
+    } else {
+        suggest_command(buffer);
+
+        // If this partial uniquely matches a built-in, autocomplete it in-place
+        char completed[128];
+        int comp = complete_builtin_command(buffer, completed, sizeof(completed));
+        if (comp == 1 && completed[0] != '\0') {
+            gap_set(&g_line, completed);
+        } else {
+            // If no built-in match, try external command completion (PATH)
+            int extc = complete_external_command(buffer, completed, sizeof(completed));
+            if (extc == 1 && completed[0] != '\0') {
+                gap_set(&g_line, completed);
+            } else if (extc == 0 &&
+                       complete_fuzzy_command(buffer, completed, sizeof(completed)) == 1) {
+                // No prefix match anywhere: take the best fuzzy match
+                gap_set(&g_line, completed);
+            }
+        }
     }
+    free(buffer);
+
+    // Redraw the normal prompt + current buffer below the suggestions
+    gap_move(&g_line, gap_length(&g_line));
+    redraw_prompt(gap_text(&g_line));
+}
+
+// Replace the line with history entry `index` (history_count() = the line
+// the user was typing before moving through history)
+static void recall_history(size_t index, const char *typed) {
+    gap_set(&g_line, index < history_count() ? history_get(index) : (typed ? typed : ""));
+}
+
+// Copy of the line just entered. It is reused from one prompt to the next,
+// so reading a command stops allocating once the buffer fits the longest line.
+static char *g_input;
+static size_t g_input_cap;
+
+static char *input_line(void) {
+    static char empty[1];
+    size_t len = gap_length(&g_line);
+
+    if (len + 1 > g_input_cap) {
+        size_t cap = g_input_cap ? g_input_cap : RIPPLE_RL_BUFSIZE;
+        while (cap < len + 1) cap *= 2;
+        char *bigger = realloc(g_input, cap);
+        if (!bigger) {
+            fprintf(stderr, "ripple: allocation error\n");
+            empty[0] = '\0';
+            return empty;
+        }
+        g_input = bigger;
+        g_input_cap = cap;
+    }
+    memcpy(g_input, gap_text(&g_line), len + 1);
+    return g_input;
+}
+
+// Read a line of input. The returned buffer belongs to the reader and is
+// overwritten by the next call; NULL means end of input.
+char *ripple_read_line(void) {
+    size_t hist_index = history_count();
+    char *typed = NULL;     // the unfinished line while browsing history
+
+    gap_set(&g_line, "");
+    screen_reset(&g_screen, "", 0);
+    g_ghost[0] = '\0';
+
     while (1) {
-        c = getchar();
+        int c = read_key();
+        if (c == 27) c = read_escape();
+
+        size_t cursor = g_line.gap_start;
+        size_t len = gap_length(&g_line);
+        int edited = 1;        // buffer contents changed
+        int typed_key = 1;     // an edit that should refresh the suggestion
+
         if (c == EOF) {
             // Only return NULL if nothing has been typed (Ctrl+D at empty prompt)
-            if (position == 0) {
-                free(buffer);
+            if (len == 0) {
+                free(typed);
+                term_flush();
                 return NULL;
-            } else {
-                continue; // Ignore spurious EOFs
             }
+            continue; // Ignore spurious EOFs
         } else if (c == '\n' || c == '\r') {  // Handle both newline and carriage return
-            buffer[position] = '\0';
-            printf("\n");  // Print newline after command input
-            return buffer;
-        } else if (c == '\t') {
-            buffer[position] = '\0';
-            // If buffer contains spaces, suggest args for the first token (e.g., gcc flags).
-            // Otherwise, suggest/complete the command name.
-            char *last_space = strrchr(buffer, ' ');
-            if (last_space != NULL) {
-                // First token = command (up to first space)
-                char cmd[128];
-                size_t cmd_len = 0;
-                while (buffer[cmd_len] && buffer[cmd_len] != ' ' && buffer[cmd_len] != '\t' && cmd_len < sizeof(cmd) - 1) {
-                    cmd[cmd_len] = buffer[cmd_len];
-                    cmd_len++;
-                }
-                cmd[cmd_len] = '\0';
-
-                // Current arg token = after last space (may be empty if trailing space)
-                const char *arg_partial = last_space + 1;
-
-                printf("\n");
-                suggest_external_args(cmd, arg_partial);
-
-                // Try to autocomplete current arg token if it uniquely matches a known flag
-                char completed_arg[128];
-                int argc = complete_external_arg(cmd, arg_partial, completed_arg, sizeof(completed_arg));
-                if (argc == 1 && completed_arg[0] != '\0') {
-                    size_t prefix_len = (size_t)(arg_partial - buffer);
-                    if (prefix_len < (size_t)bufsize) {
-                        snprintf(buffer + prefix_len, (size_t)bufsize - prefix_len, "%s", completed_arg);
-                        position = (int)strlen(buffer);
-                    }
-                }
-            } else {
-                char *current_cmd = strdup(buffer);
-                suggest_command(current_cmd);
-                free(current_cmd);
-
-                // If this partial uniquely matches a built-in, autocomplete it in-place
-                char completed[128];
-                int comp = complete_builtin_command(buffer, completed, sizeof(completed));
-                if (comp == 1 && completed[0] != '\0') {
-                    snprintf(buffer, bufsize, "%s", completed);
-                    position = (int)strlen(buffer);
-                } else {
-                    // If no built-in match, try external command completion (PATH)
-                    int extc = complete_external_command(buffer, completed, sizeof(completed));
-                    if (extc == 1 && completed[0] != '\0') {
-                        snprintf(buffer, bufsize, "%s", completed);
-                        position = (int)strlen(buffer);
-                    }
-                }
+            ai_async_cancel(); // Pending suggestion is for a line we no longer edit
+            free(typed);
+            clear_ghost();
+            term_puts("\n");  // Print newline after command input
+            term_flush();
+            return input_line();
+        } else if (c == 4) { // Ctrl-D: EOF on an empty line, else delete under cursor
+            if (len == 0) {
+                free(typed);
+                term_puts("\n");
+                term_flush();
+                return NULL;
             }
-            // Redraw the normal prompt + current buffer
-            char cwd[1024];
-            if (getcwd(cwd, sizeof(cwd)) != NULL) {
-                printf("\033[1;95m┌─[\033[1;96m%s\033[1;95m]\033[0m\n", cwd);
-                printf("\033[1;95m└─▶\033[0m \033[1;92m%s\033[0m", buffer);
-            } else {
-                printf("\033[1;95m└─▶\033[0m \033[1;92m%s\033[0m", buffer);
+            gap_delete_after(&g_line, 1);
+        } else if (c == 3) { // Ctrl-C: drop the line
+            ai_async_cancel();
+            free(typed);
+            clear_ghost();
+            term_puts("^C\n");
+            term_flush();
+            gap_set(&g_line, "");
+            return input_line();
+        } else if (c == 18) { // Ctrl-R: reverse history search
+            free(typed);
+            typed = NULL;
+            hist_index = history_count();
+            if (reverse_search()) {
+                term_puts("\n");
+                term_flush();
+                return input_line();
             }
-            fflush(stdout);
             continue;
+        } else if (c == '\t') {
+            complete_line();
+            continue;
+        } else if (c == 12) { // Ctrl-L: clear the screen, keep the line
+            term_puts(TERM_CLEAR_SCREEN);
+            redraw_prompt(gap_text(&g_line));
+            gap_move(&g_line, cursor);
+            edited = 0;
+            typed_key = 0;
         } else if (c == 127 || c == '\b') { // Handle backspace (DEL or BS)
-            if (position > 0) {
-                position--;
-                // Move cursor back, print space to erase character, move back again
-                printf("\b \b");
-                fflush(stdout);
-            } else {
-                // At beginning of line, just ignore backspace
-                continue;
+            if (cursor == 0) continue;
+            gap_delete_before(&g_line, 1);
+        } else if (c == KEY_DELETE) {
+            if (cursor == len) continue;
+            gap_delete_after(&g_line, 1);
+        } else if (c == 23) { // Ctrl-W: delete the word before the cursor
+            gap_delete_before(&g_line, cursor - gap_word_left(&g_line, cursor));
+        } else if (c == KEY_DELETE_WORD) {
+            gap_delete_after(&g_line, gap_word_right(&g_line, cursor) - cursor);
+        } else if (c == 21) { // Ctrl-U: delete to the start of the line
+            gap_delete_before(&g_line, cursor);
+        } else if (c == 11) { // Ctrl-K: delete to the end of the line
+            gap_delete_after(&g_line, len - cursor);
+        } else if ((c == KEY_RIGHT || c == 6 || c == KEY_END || c == 5) && visible_ghost()) {
+            // At the end of the line these accept the inline suggestion
+            gap_insert(&g_line, g_ghost, strlen(g_ghost));
+        } else if (c == KEY_LEFT || c == 2) { // Ctrl-B
+            if (cursor > 0) gap_move(&g_line, cursor - 1);
+            edited = typed_key = 0;
+        } else if (c == KEY_RIGHT || c == 6) { // Ctrl-F
+            gap_move(&g_line, cursor + 1);
+            edited = typed_key = 0;
+        } else if (c == KEY_HOME || c == 1) { // Ctrl-A
+            gap_move(&g_line, 0);
+            edited = typed_key = 0;
+        } else if (c == KEY_END || c == 5) { // Ctrl-E
+            gap_move(&g_line, len);
+            edited = typed_key = 0;
+        } else if (c == KEY_WORD_LEFT) {
+            gap_move(&g_line, gap_word_left(&g_line, cursor));
+            edited = typed_key = 0;
+        } else if (c == KEY_WORD_RIGHT) {
+            gap_move(&g_line, gap_word_right(&g_line, cursor));
+            edited = typed_key = 0;
+        } else if (c == KEY_UP || c == 16) { // Ctrl-P: older history entry
+            if (hist_index == 0) continue;
+            if (hist_index == history_count()) {
+                free(typed);
+                typed = gap_strdup(&g_line);
             }
+            recall_history(--hist_index, typed);
+            g_ghost[0] = '\0';
+            typed_key = 0;
+        } else if (c == KEY_DOWN || c == 14) { // Ctrl-N: newer history entry
+            if (hist_index >= history_count()) continue;
+            recall_history(++hist_index, typed);
+            g_ghost[0] = '\0';
+            typed_key = 0;
         } else if (c >= 32 && c < 127) { // Only accept printable characters
-            // Regular printable character
-            if (position >= bufsize - 1) {
-                bufsize += RIPPLE_RL_BUFSIZE;
-                buffer = realloc(buffer, bufsize);
-                if (!buffer) {
-                    fprintf(stderr, "ripple: allocation error\n");
-                    exit(EXIT_FAILURE);
+            char ch = (char)c;
+            gap_insert(&g_line, &ch, 1);
+        } else {
+            continue;
+        }
+
+        if (edited) ai_async_cancel(); // Buffer changed: drop the stale AI request
+        if (typed_key) update_ghost();
+        screen_render(&g_screen, &g_line, visible_ghost());
+    }
+}
+
+// Replay the command names of the newest history lines into the frecency
+// table, so completion ranking carries over from earlier sessions
+static void seed_frecency(void) {
+    Arena arena;
+    arena_init(&arena, 0);
+    size_t n = history_count();
+    for (size_t i = n > RIPPLE_FRECENCY_SEED ? n - RIPPLE_FRECENCY_SEED : 0; i < n; i++) {
+        arena_reset(&arena);
+        // The parser cuts words in place, so it gets a copy
+        char *line = arena_strdup(&arena, history_get(i));
+        const char *error;
+        CommandList *list = line ? parse_command_line(&arena, line, &error) : NULL;
+        if (!list) continue;
+        for (int a = 0; a < list->count; a++) {
+            const AndOr *ao = &list->items[a];
+            for (int p = 0; p < ao->count; p++) {
+                const Pipeline *pl = &ao->pipelines[p];
+                for (int c = 0; c < pl->count; c++) {
+                    if (pl->commands[c].argv[0]) frecency_seed(pl->commands[c].argv[0]);
                 }
             }
-            buffer[position] = c;
-            position++;
-            // Manually echo the character since ECHO is disabled
-            putchar(c);
-            fflush(stdout);
         }
     }
+    arena_free(&arena);
 }
 
 // Main entry point
 int main(void) {
+    // A builtin writing into a closed pipe or fifo gets EPIPE and returns to
+    // the prompt instead of taking the shell down
+    signal(SIGPIPE, SIG_IGN);
+
+    // Start indexing $PATH right away so the first TAB finds it ready
+    path_index_start_background();
+    history_open();
+    seed_frecency();
+
     // Print neon-styled welcome message
-    printf("\033[40m\033[2J\033[H"); // Clear screen and set black background
-    printf("\n");
-    printf("\033[1;35m╔═══════════════════════════════════════════════════════════════╗\033[0m\n");
-    printf("\033[1;35m║\033[0m                                                               \033[1;35m║\033[0m\n");
-    printf("\033[1;35m║\033[0m        \033[1;96m⚡ AI-POWERED CUSTOM SHELL v1.0 ⚡\033[0m              \033[1;35m║\033[0m\n");
-    printf("\033[1;35m║\033[0m           \033[1;93m『 Neon Command Interface 』\033[0m                \033[1;35m║\033[0m\n");
-    printf("\033[1;35m║\033[0m                                                               \033[1;35m║\033[0m\n");
-    printf("\033[1;35m╚═══════════════════════════════════════════════════════════════╝\033[0m\n\n");
+    term_puts("\033[40m\033[2J\033[H"); // Clear screen and set black background
+    term_puts("\n");
+    term_puts(TERM_MAGENTA "╔═══════════════════════════════════════════════════════════════╗" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "║" TERM_RESET "                                                               " TERM_MAGENTA "║" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "║" TERM_RESET "        " TERM_CYAN "⚡ AI-POWERED CUSTOM SHELL v1.0 ⚡" TERM_RESET "              " TERM_MAGENTA "║" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "║" TERM_RESET "           " TERM_YELLOW "『 Neon Command Interface 』" TERM_RESET "                " TERM_MAGENTA "║" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "║" TERM_RESET "                                                               " TERM_MAGENTA "║" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "╚═══════════════════════════════════════════════════════════════╝" TERM_RESET "\n\n");
     
-    printf("\033[1;96m┌─ \033[1;92mQuick Start Guide\033[0m\033[1;96m ─────────────────────────────────────────┐\033[0m\n");
-    printf("\033[1;96m│\033[0m                                                               \033[1;96m│\033[0m\n");
-    printf("\033[1;96m│\033[0m  \033[1;93m▸\033[0m Type any command and press \033[1;95mTAB\033[0m for AI suggestions       \033[1;96m│\033[0m\n");
-    printf("\033[1;96m│\033[0m  \033[1;93m▸\033[0m Try: \033[1;92mhelp\033[0m, \033[1;92mversion\033[0m, \033[1;92mcalc\033[0m, \033[1;92mls\033[0m                       \033[1;96m│\033[0m\n");
-    printf("\033[1;96m│\033[0m  \033[1;93m▸\033[0m Partial commands auto-complete: \033[1;92mver\033[0m → \033[1;92mversion\033[0m        \033[1;96m│\033[0m\n");
-    printf("\033[1;96m│\033[0m  \033[1;93m▸\033[0m External commands get smart help: \033[1;92mgcc\033[0m, \033[1;92mgit\033[0m        \033[1;96m│\033[0m\n");
-    printf("\033[1;96m│\033[0m                                                               \033[1;96m│\033[0m\n");
-    printf("\033[1;96m└───────────────────────────────────────────────────────────────┘\033[0m\n\n");
+    term_puts(TERM_CYAN "┌─ " TERM_GREEN "Quick Start Guide" TERM_RESET TERM_CYAN " ─────────────────────────────────────────┐" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "                                                               " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "  " TERM_YELLOW "▸" TERM_RESET " Type any command and press " TERM_PINK "TAB" TERM_RESET " for AI suggestions       " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "  " TERM_YELLOW "▸" TERM_RESET " Try: " TERM_GREEN "help" TERM_RESET ", " TERM_GREEN "version" TERM_RESET ", " TERM_GREEN "calc" TERM_RESET ", " TERM_GREEN "ls" TERM_RESET "                       " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "  " TERM_YELLOW "▸" TERM_RESET " Partial commands auto-complete: " TERM_GREEN "ver" TERM_RESET " → " TERM_GREEN "version" TERM_RESET "        " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "  " TERM_YELLOW "▸" TERM_RESET " External commands get smart help: " TERM_GREEN "gcc" TERM_RESET ", " TERM_GREEN "git" TERM_RESET "        " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "│" TERM_RESET "                                                               " TERM_CYAN "│" TERM_RESET "\n");
+    term_puts(TERM_CYAN "└───────────────────────────────────────────────────────────────┘" TERM_RESET "\n\n");
     
-    printf("\033[1;90m💡 Tip: Make sure Ollama is running (tinyllama model)\033[0m\n\n");
+    term_puts(TERM_GRAY "💡 Tip: Make sure Ollama is running (tinyllama model)" TERM_RESET "\n\n");
     
+    // Create the Ollama client once so every AI lookup reuses its connection,
+    // and run lookups on a worker thread so typing never waits on the network
+    ollama_client_init();
+    ai_async_start();
+
     // Run command loop
     ripple_loop();
+
+    ai_async_stop();
+    ollama_client_cleanup();
+    history_close();
     
-    printf("\n\033[1;35m╔═══════════════════════════════════════════════════════════════╗\033[0m\n");
-    printf("\033[1;35m║\033[0m           \033[1;96mThank you for using Neon Shell!\033[0m              \033[1;35m║\033[0m\n");
-    printf("\033[1;35m╚═══════════════════════════════════════════════════════════════╝\033[0m\n\n");
-    
+    term_puts("\n" TERM_MAGENTA "╔═══════════════════════════════════════════════════════════════╗" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "║" TERM_RESET "           " TERM_CYAN "Thank you for using Neon Shell!" TERM_RESET "              " TERM_MAGENTA "║" TERM_RESET "\n");
+    term_puts(TERM_MAGENTA "╚═══════════════════════════════════════════════════════════════╝" TERM_RESET "\n\n");
+    term_flush();
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,69 @@
+#include "term.h"
+#include <unistd.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The frame being assembled; kept between frames so steady-state
+// rendering does not allocate
+static struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+} g_term;
+
+static int term_reserve(size_t n) {
+    if (g_term.len + n <= g_term.cap) return 1;
+    size_t cap = g_term.cap ? g_term.cap : TERM_INITIAL_SIZE;
+    while (cap < g_term.len + n) cap *= 2;
+    char *buf = realloc(g_term.buf, cap);
+    if (!buf) return 0;
+    g_term.buf = buf;
+    g_term.cap = cap;
+    return 1;
+}
+
+void term_write(const char* s, size_t n) {
+    if (n == 0 || !term_reserve(n)) return;
+    memcpy(g_term.buf + g_term.len, s, n);
+    g_term.len += n;
+}
+
+void term_puts(const char* s) {
+    term_write(s, strlen(s));
+}
+
+void term_putc(char c) {
+    if (g_term.len < g_term.cap || term_reserve(1)) g_term.buf[g_term.len++] = c;
+}
+
+void term_printf(const char* fmt, ...) {
+    // Format straight into the free space; grow and retry when it is short
+    va_list ap;
+    va_start(ap, fmt);
+    size_t room = g_term.cap - g_term.len;
+    int n = vsnprintf(room ? g_term.buf + g_term.len : NULL, room, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= room) {
+        if (!term_reserve((size_t)n + 1)) return;
+        va_start(ap, fmt);
+        vsnprintf(g_term.buf + g_term.len, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    g_term.len += (size_t)n;
+}
+
+void term_flush(void) {
+    fflush(stdout);
+    size_t off = 0;
+    while (off < g_term.len) {
+        ssize_t n = write(STDOUT_FILENO, g_term.buf + off, g_term.len - off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        off += (size_t)n;
+    }
+    g_term.len = 0;
+}
@@ -0,0 +1,37 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stddef.h>
+
+// Buffered terminal output for everything drawn while the line editor is in
+// charge: the prompt, the editor's redraws, TAB suggestions, help pages and
+// AI text. Output is appended to one reusable buffer and sent with a single
+// write() by term_flush(), which read_key calls right before it waits for
+// the next key, so each keystroke produces at most one frame.
+//
+// Main thread only. Anything written with stdio earlier is flushed first,
+// so mixing is safe as long as no printf comes between term_* calls and
+// the next term_flush().
+void term_write(const char* s, size_t n);
+void term_puts(const char* s);
+void term_putc(char c);
+void term_printf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
+void term_flush(void);
+
+// Styles as string literals, so "TERM_CYAN "text" TERM_RESET" is one
+// constant assembled at compile time
+#define TERM_RESET          "\033[0m"
+#define TERM_MAGENTA        "\033[1;35m"
+#define TERM_GRAY           "\033[1;90m"
+#define TERM_GREEN          "\033[1;92m"
+#define TERM_YELLOW         "\033[1;93m"
+#define TERM_PINK           "\033[1;95m"
+#define TERM_CYAN           "\033[1;96m"
+#define TERM_GHOST          "\033[0;90m"
+#define TERM_CLEAR_LINE     "\r\033[K"
+#define TERM_CLEAR_SCREEN   "\033[H\033[2J"
+
+// Constants
+#define TERM_INITIAL_SIZE 4096
+
+#endif // TERM_H
@@ -0,0 +1,423 @@
+#include "walk.h"
+#include "dir_iter.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <stdatomic.h>
+
+// An open directory shared by the tasks for its subdirectories: each of
+// them opens its own directory relative to this one, and the last to do so
+// closes it. Only so many are kept open at once (Walk.max_refs); the
+// subdirectories of a directory read past that point carry no parent and
+// are opened by their full path instead.
+typedef struct {
+    int fd;
+    atomic_int refs;
+} DirRef;
+
+// One directory waiting to be read
+typedef struct {
+    char *path;             // from the root, malloc'd
+    size_t len;
+    DirRef *parent;         // NULL: open path from the working directory
+    const char *name;       // last component, inside path
+} WalkTask;
+
+// Owner pushes and pops at the tail (depth first, warm caches); thieves
+// take from the head, where the oldest and usually biggest subtrees are.
+typedef struct {
+    pthread_mutex_t lock;
+    WalkTask *items;
+    size_t head;
+    size_t tail;
+    size_t cap;
+} WalkDeque;
+
+typedef struct Walk Walk;
+
+struct WalkWorker {
+    Walk *walk;
+    int id;
+    pthread_t thread;
+    WalkDeque deque;
+    long long *dirbuf;      // DIR_ITER_BUFSIZE, reused for every directory
+    char *out;
+    size_t out_len;
+    unsigned long long counters[WALK_COUNTERS];
+};
+
+struct Walk {
+    WalkWorker *workers;
+    int nworkers;
+    atomic_long pending;    // tasks queued or being read
+    atomic_long queued;     // tasks sitting in a deque
+    atomic_int idle;        // workers parked on idle_cond
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    atomic_int open_refs;   // DirRefs holding a descriptor
+    int max_refs;
+    const char *who;        // command name for error messages
+    walk_visit_fn visit;
+    void *user;
+    pthread_mutex_t out_lock;
+};
+
+static void dirref_release(Walk *walk, DirRef *ref) {
+    if (ref && atomic_fetch_sub(&ref->refs, 1) == 1) {
+        close(ref->fd);
+        free(ref);
+        atomic_fetch_sub(&walk->open_refs, 1);
+    }
+}
+
+// Claim one of the max_refs descriptors a walk may keep open
+static int dirref_reserve(Walk *walk) {
+    if (atomic_fetch_add(&walk->open_refs, 1) < walk->max_refs) return 1;
+    atomic_fetch_sub(&walk->open_refs, 1);
+    return 0;
+}
+
+static int deque_push(WalkDeque *q, const WalkTask *t) {
+    pthread_mutex_lock(&q->lock);
+    if (q->tail == q->cap) {
+        if (q->head > 0) {
+            // Reuse the room left by steals before growing
+            memmove(q->items, q->items + q->head, (q->tail - q->head) * sizeof(WalkTask));
+            q->tail -= q->head;
+            q->head = 0;
+        }
+        if (q->tail == q->cap) {
+            size_t cap = q->cap ? q->cap * 2 : 64;
+            WalkTask *items = realloc(q->items, cap * sizeof(WalkTask));
+            if (!items) {
+                pthread_mutex_unlock(&q->lock);
+                return 0;
+            }
+            q->items = items;
+            q->cap = cap;
+        }
+    }
+    q->items[q->tail++] = *t;
+    pthread_mutex_unlock(&q->lock);
+    return 1;
+}
+
+static int deque_pop(WalkDeque *q, WalkTask *t) {
+    int found = 0;
+    pthread_mutex_lock(&q->lock);
+    if (q->tail > q->head) {
+        *t = q->items[--q->tail];
+        found = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+static int deque_steal(WalkDeque *q, WalkTask *t) {
+    int found = 0;
+    // Do not queue up behind a busy owner; try the next victim instead
+    if (pthread_mutex_trylock(&q->lock) != 0) return 0;
+    if (q->tail > q->head) {
+        *t = q->items[q->head++];
+        found = 1;
+    }
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+// Wake one parked worker for a newly queued task. Pairs with park_worker():
+// the task is counted before idle is read here, and idle is raised before
+// queued is read there, so either the worker sees the task or we see it.
+static void wake_worker(Walk *walk) {
+    if (atomic_load(&walk->idle) == 0) return;
+    pthread_mutex_lock(&walk->idle_lock);
+    pthread_cond_signal(&walk->idle_cond);
+    pthread_mutex_unlock(&walk->idle_lock);
+}
+
+// Sleep until there is a task to take or the walk is over, instead of
+// spinning through the other deques while one thread reads a deep, narrow
+// branch.
+static void park_worker(Walk *walk) {
+    pthread_mutex_lock(&walk->idle_lock);
+    atomic_fetch_add(&walk->idle, 1);
+    while (atomic_load(&walk->queued) == 0 && atomic_load(&walk->pending) != 0) {
+        pthread_cond_wait(&walk->idle_cond, &walk->idle_lock);
+    }
+    atomic_fetch_sub(&walk->idle, 1);
+    pthread_mutex_unlock(&walk->idle_lock);
+}
+
+static void flush_output(WalkWorker *w) {
+    if (w->out_len == 0) return;
+    pthread_mutex_lock(&w->walk->out_lock);
+    size_t done = 0;
+    while (done < w->out_len) {
+        ssize_t n = write(STDOUT_FILENO, w->out + done, w->out_len - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    pthread_mutex_unlock(&w->walk->out_lock);
+    w->out_len = 0;
+}
+
+void walk_emit(WalkWorker* w, const char* data, size_t len) {
+    while (len > 0) {
+        if (w->out_len == WALK_OUT_BUFSIZE) flush_output(w);
+        size_t n = WALK_OUT_BUFSIZE - w->out_len;
+        if (n > len) n = len;
+        memcpy(w->out + w->out_len, data, n);
+        w->out_len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void walk_emit_path(WalkWorker* w, const WalkEntry* e) {
+    // Keep a line in one batch when it fits
+    if (WALK_OUT_BUFSIZE - w->out_len < e->dir_len + e->name_len + 2) flush_output(w);
+    walk_emit(w, e->dir, e->dir_len);
+    if (e->dir_len == 0 || e->dir[e->dir_len - 1] != '/') walk_emit(w, "/", 1);
+    walk_emit(w, e->name, e->name_len);
+    walk_emit(w, "\n", 1);
+}
+
+void walk_count(WalkWorker* w, int counter, unsigned long long n) {
+    if (counter >= 0 && counter < WALK_COUNTERS) w->counters[counter] += n;
+}
+
+static unsigned char mode_to_type(mode_t mode) {
+    if (S_ISREG(mode)) return DT_REG;
+    if (S_ISDIR(mode)) return DT_DIR;
+    if (S_ISLNK(mode)) return DT_LNK;
+    if (S_ISFIFO(mode)) return DT_FIFO;
+    if (S_ISSOCK(mode)) return DT_SOCK;
+    if (S_ISCHR(mode)) return DT_CHR;
+    if (S_ISBLK(mode)) return DT_BLK;
+    return DT_UNKNOWN;
+}
+
+static void queue_subdir(WalkWorker *w, const WalkTask *t, DirRef *self,
+                         const char *name, size_t name_len) {
+    int slash = t->len == 0 || t->path[t->len - 1] != '/';
+    WalkTask child;
+    child.len = t->len + (size_t)slash + name_len;
+    child.path = malloc(child.len + 1);
+    if (!child.path) return;
+    memcpy(child.path, t->path, t->len);
+    if (slash) child.path[t->len] = '/';
+    memcpy(child.path + t->len + slash, name, name_len + 1);
+    child.name = child.path + t->len + slash;
+    child.parent = self;
+
+    if (self) atomic_fetch_add(&self->refs, 1);
+    atomic_fetch_add(&w->walk->pending, 1);
+    if (!deque_push(&w->deque, &child)) {
+        atomic_fetch_sub(&w->walk->pending, 1);
+        dirref_release(w->walk, self);
+        free(child.path);
+        return;
+    }
+    atomic_fetch_add(&w->walk->queued, 1);
+    wake_worker(w->walk);
+}
+
+// Read one directory, visiting its entries and queueing its subdirectories
+static void read_task(WalkWorker *w, WalkTask *t) {
+    Walk *walk = w->walk;
+    DirIter it;
+    int opened;
+    if (t->parent) {
+        opened = dir_iter_open(&it, t->parent->fd, t->name, w->dirbuf, DIR_ITER_BUFSIZE);
+        if (opened != 0 && (errno == EMFILE || errno == ENFILE)) {
+            // Out of descriptors: give back the parent's and go by full path
+            dirref_release(walk, t->parent);
+            t->parent = NULL;
+        }
+    }
+    if (!t->parent) {
+        opened = dir_iter_open(&it, AT_FDCWD, t->path, w->dirbuf, DIR_ITER_BUFSIZE);
+    }
+    int err = errno;
+    dirref_release(walk, t->parent);
+    if (opened != 0) {
+        fprintf(stderr, "ripple: %s: %s: %s\n", walk->who, t->path, strerror(err));
+        free(t->path);
+        return;
+    }
+
+    // Created with the first subdirectory; held by this reader until it is
+    // done, then by the queued children. Without one to spare the children
+    // are queued with no parent.
+    DirRef *self = NULL;
+    int reserved = 0;
+    int fd = dir_iter_fd(&it);
+    DirEntry ent;
+    while (dir_iter_next(&it, &ent) > 0) {
+        WalkEntry e;
+        e.dir = t->path;
+        e.dir_len = t->len;
+        e.name = ent.name;
+        e.name_len = ent.name_len;
+        e.dir_fd = fd;
+        e.type = ent.type;
+        if (e.type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(fd, ent.name, &st, AT_SYMLINK_NOFOLLOW) != 0) continue;
+            e.type = mode_to_type(st.st_mode);
+        }
+
+        walk->visit(w, &e, walk->user);
+        if (e.type != DT_DIR) continue;
+        if (!self && !reserved++ && dirref_reserve(walk)) {
+            self = malloc(sizeof(DirRef));
+            if (self) {
+                self->fd = dir_iter_take_fd(&it);
+                atomic_init(&self->refs, 1);
+            } else {
+                atomic_fetch_sub(&walk->open_refs, 1);
+            }
+        }
+        queue_subdir(w, t, self, ent.name, ent.name_len);
+    }
+
+    dir_iter_close(&it);
+    dirref_release(walk, self);
+    free(t->path);
+}
+
+static int find_task(WalkWorker *w, WalkTask *t) {
+    Walk *walk = w->walk;
+    int found = deque_pop(&w->deque, t);
+    for (int i = 1; !found && i < walk->nworkers; i++) {
+        WalkWorker *victim = &walk->workers[(w->id + i) % walk->nworkers];
+        found = deque_steal(&victim->deque, t);
+    }
+    if (found) atomic_fetch_sub(&walk->queued, 1);
+    return found;
+}
+
+static void *worker_main(void *arg) {
+    WalkWorker *w = arg;
+    Walk *walk = w->walk;
+    WalkTask t;
+
+    for (;;) {
+        if (find_task(w, &t)) {
+            read_task(w, &t);
+            if (atomic_fetch_sub(&walk->pending, 1) == 1) {
+                // Last task done: release everyone parked
+                pthread_mutex_lock(&walk->idle_lock);
+                pthread_cond_broadcast(&walk->idle_cond);
+                pthread_mutex_unlock(&walk->idle_lock);
+            }
+        } else if (atomic_load(&walk->pending) == 0) {
+            break;
+        } else if (atomic_load(&walk->queued) == 0) {
+            park_worker(walk);
+        } else {
+            // A task is queued but its deque was busy; try again
+            sched_yield();
+        }
+    }
+    flush_output(w);
+    return NULL;
+}
+
+int walk_tree(const char* who, const char* root, int threads, walk_visit_fn visit,
+              void* user, unsigned long long counters[]) {
+    if (threads <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    if (threads > WALK_MAX_THREADS) threads = WALK_MAX_THREADS;
+
+    // Fail early, and in the caller, if the root is unusable
+    int probe = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (probe < 0) return -1;
+    close(probe);
+
+    Walk walk;
+    walk.nworkers = threads;
+    walk.who = who;
+    atomic_init(&walk.open_refs, 0);
+    // Leave most of the descriptor limit to the workers' own directories
+    // and whatever else the shell has open
+    walk.max_refs = WALK_MAX_OPEN_DIRS;
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur != RLIM_INFINITY &&
+        lim.rlim_cur / 4 < (rlim_t)walk.max_refs) {
+        walk.max_refs = (int)(lim.rlim_cur / 4);
+    }
+    walk.visit = visit;
+    walk.user = user;
+    atomic_init(&walk.pending, 1);
+    atomic_init(&walk.queued, 1);
+    atomic_init(&walk.idle, 0);
+    pthread_mutex_init(&walk.idle_lock, NULL);
+    pthread_cond_init(&walk.idle_cond, NULL);
+    pthread_mutex_init(&walk.out_lock, NULL);
+    walk.workers = calloc((size_t)threads, sizeof(WalkWorker));
+    if (!walk.workers) return -1;
+    for (int i = 0; i < threads; i++) {
+        walk.workers[i].walk = &walk;
+        walk.workers[i].id = i;
+        pthread_mutex_init(&walk.workers[i].deque.lock, NULL);
+        walk.workers[i].out = malloc(WALK_OUT_BUFSIZE);
+        walk.workers[i].dirbuf = malloc(DIR_ITER_BUFSIZE);
+        if (!walk.workers[i].out || !walk.workers[i].dirbuf) {
+            free(walk.workers[i].out);
+            free(walk.workers[i].dirbuf);
+            walk.nworkers = threads = i;
+            break;
+        }
+    }
+
+    WalkTask first = { strdup(root), strlen(root), NULL, NULL };
+    if (threads == 0 || !first.path || !deque_push(&walk.workers[0].deque, &first)) {
+        free(first.path);
+        atomic_store(&walk.pending, 0);
+        atomic_store(&walk.queued, 0);
+    }
+
+    // Output written straight to the descriptor must follow what stdio holds
+    fflush(stdout);
+
+    int started = 1;
+    while (started < threads &&
+           pthread_create(&walk.workers[started].thread, NULL, worker_main, &walk.workers[started]) == 0) {
+        started++;
+    }
+    if (threads > 0) worker_main(&walk.workers[0]);
+    for (int i = 1; i < started; i++) {
+        pthread_join(walk.workers[i].thread, NULL);
+    }
+
+    for (int c = 0; c < WALK_COUNTERS; c++) {
+        if (counters) counters[c] = 0;
+    }
+    for (int i = 0; i < threads; i++) {
+        for (int c = 0; c < WALK_COUNTERS && counters; c++) {
+            counters[c] += walk.workers[i].counters[c];
+        }
+        free(walk.workers[i].deque.items);
+        free(walk.workers[i].out);
+        free(walk.workers[i].dirbuf);
+        pthread_mutex_destroy(&walk.workers[i].deque.lock);
+    }
+    free(walk.workers);
+    pthread_mutex_destroy(&walk.out_lock);
+    pthread_mutex_destroy(&walk.idle_lock);
+    pthread_cond_destroy(&walk.idle_cond);
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef WALK_H
+#define WALK_H
+
+#include <stddef.h>
+
+// Parallel directory-tree walker shared by the directory builtins.
+// Every directory is opened with openat() relative to its parent's
+// descriptor, entry types come from d_type (fstatat() only when the
+// filesystem does not fill it in) and symbolic links are not followed.
+// At most WALK_MAX_OPEN_DIRS parent descriptors are held open; beyond that,
+// or when the process runs out of descriptors, directories are opened by
+// their full path. Directories that cannot be read are reported on stderr
+// as "ripple: who: path: error" and the walk goes on.
+// Subdirectories are queued on the finding worker's deque; idle workers
+// steal the oldest (largest) subtrees from the others. Visit order is
+// therefore unspecified when more than one thread runs.
+typedef struct WalkWorker WalkWorker;
+
+typedef struct {
+    const char *dir;        // path of the containing directory, from the root
+    size_t dir_len;
+    const char *name;       // NUL-terminated, valid during the callback only
+    size_t name_len;
+    int dir_fd;             // open descriptor of the containing directory
+    unsigned char type;     // DT_REG, DT_DIR, DT_LNK, ... never DT_UNKNOWN
+} WalkEntry;
+
+// Called for every entry below the root, possibly from several threads at
+// once; per-walk state should go through walk_emit() and walk_count().
+typedef void (*walk_visit_fn)(WalkWorker* w, const WalkEntry* e, void* user);
+
+// Walk everything below root with up to threads workers (0 = one per CPU).
+// who names the command in error messages. counters receives the
+// per-worker walk_count() totals. Returns 0, or -1 with errno set if root
+// itself cannot be opened.
+int walk_tree(const char* who, const char* root, int threads, walk_visit_fn visit,
+              void* user, unsigned long long counters[]);
+
+// Append to the worker's output batch; batches go to stdout whole, so lines
+// from different workers never interleave
+void walk_emit(WalkWorker* w, const char* data, size_t len);
+void walk_emit_path(WalkWorker* w, const WalkEntry* e);   // "dir/name\n"
+void walk_count(WalkWorker* w, int counter, unsigned long long n);
+
+// Constants
+#define WALK_COUNTERS 8
+#define WALK_MAX_THREADS 16
+#define WALK_OUT_BUFSIZE 65536
+#define WALK_MAX_OPEN_DIRS 256         // lowered to a quarter of RLIMIT_NOFILE
+
+#endif // WALK_H